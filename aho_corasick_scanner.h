@@ -0,0 +1,218 @@
+#ifndef PREFIX_TREE_AHO_CORASICK_SCANNER_H
+#define PREFIX_TREE_AHO_CORASICK_SCANNER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util/key_range.h"
+
+// Aho-Corasick automaton over the keys of a prefix tree, built by prefix_tree::scanner.
+// Each letter of a key is a state: the prefixes of the tree nodes are expanded into chains of states,
+// numbered in BFS order so that the transitions of state s are the labels [edge_starts[s], edge_starts[s + 1])
+// sorted by letter. The failure link of a state goes to the state of its longest proper suffix which is a
+// prefix of some key, its output link to the state of its longest proper suffix which is a key.
+// A scan reads each letter once and follows failure links on mismatches, so it is linear in the text
+// plus the number of matches. The empty key never matches.
+template<class K, class T, class Charset>
+class aho_corasick_scanner
+{
+public:
+    typedef std::size_t size_type;
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef Charset charset_type;
+    typedef aho_corasick_scanner<key_type, mapped_type, charset_type> type;
+    typedef mapped_type value_type;
+
+    typedef typename charset_type::letter_type letter_type;
+    typedef typename std::conditional<(charset_type::size <= 256), std::uint8_t, std::uint32_t>::type label_type;
+    typedef std::uint32_t state_type;
+
+    static constexpr state_type none = std::numeric_limits<state_type>::max();
+
+    // where a scan over text given in chunks stands, matches across chunk boundaries are reported
+    // by the chunk holding their last letter
+    struct cursor
+    {
+        state_type state = 0;
+        size_type offset = 0;   // letters read so far
+    };
+
+    template<typename Node>
+    static type build(const Node * root, const charset_type & abc)
+    {
+        type result(abc);
+        result.expand(root);
+        result.link();
+        return result;
+    }
+
+    // call f(position, length, value) for each occurrence of a key in text, position being the offset
+    // of its first letter. Occurrences are reported by increasing end, the longest first for a same end.
+    template<class Text, class F>
+    void scan(const Text & text, F f) const
+    {
+        cursor c;
+        scan(c, text, f);
+    }
+
+    // scan the next chunk of a text, positions are offsets from the start of the first chunk
+    template<class Text, class F>
+    void scan(cursor & c, const Text & text, F f) const
+    {
+        auto letters = key_range<letter_type, Text>::letters(text);
+        state_type s = c.state;
+        size_type offset = c.offset;
+        for(auto it = letters.first; it != letters.second; ++it)
+        {
+            ++offset;
+            size_type i = (size_type)abc.to_int_type(*it);
+            s = i < charset_type::size ? next(s, (label_type)i) : 0;
+            for(state_type o = values_of[s] != none ? s : outputs[s]; o != none; o = outputs[o])
+            {
+                f(offset - depths[o], (size_type)depths[o], values[values_of[o]]);
+            }
+        }
+        c.state = s;
+        c.offset = offset;
+    }
+
+    // number of automaton states, one per letter of the tree plus the root
+    size_type states() const noexcept
+    {
+        return depths.size();
+    }
+
+    size_type size() const noexcept
+    {
+        return values.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return values.empty();
+    }
+
+private:
+    explicit aho_corasick_scanner(const charset_type & abc)
+    :abc(abc)
+    ,root_next(charset_type::size, 0)
+    {
+    }
+
+    // one state per letter of the tree, in BFS order of the letters
+    template<typename Node>
+    void expand(const Node * root)
+    {
+        // (state, node, letters of its prefix already read)
+        std::deque<std::tuple<state_type, const Node *, size_type> > queue;
+        edge_starts.push_back(0);
+        queue.emplace_back(add_state(0), root, 0);
+        while(!queue.empty())
+        {
+            state_type s = std::get<0>(queue.front());
+            const Node * n = std::get<1>(queue.front());
+            size_type read = std::get<2>(queue.front());
+            queue.pop_front();
+            size_type length = (size_type)std::distance(n->prefix_begin(), n->prefix_end());
+            if(read < length)
+            {
+                add_edge((label_type)abc.to_int_type(*std::next(n->prefix_begin(), read)), depths[s]);
+                queue.emplace_back(edge_targets.back(), n, read + 1);
+            }
+            else
+            {
+                if(n->get_value() && s != 0)
+                {
+                    values_of[s] = (state_type)values.size();
+                    values.push_back(Node::storage_type::value(*n->get_value()));
+                }
+                for(typename Node::const_iterator it = n->begin(), last = n->end(); it != last; ++it)
+                {
+                    add_edge((label_type)it.index(), depths[s]);
+                    queue.emplace_back(edge_targets.back(), *it, 0);
+                }
+            }
+            edge_starts.push_back((state_type)edge_labels.size());
+        }
+        edge_labels.shrink_to_fit();
+        edge_targets.shrink_to_fit();
+        values.shrink_to_fit();
+    }
+
+    // failure and output links, states being in BFS order their links are set before their sub states
+    void link()
+    {
+        fails.assign(depths.size(), 0);
+        outputs.assign(depths.size(), none);
+        for(state_type e = edge_starts[0]; e != edge_starts[1]; ++e)
+        {
+            root_next[edge_labels[e]] = edge_targets[e];
+        }
+        for(state_type s = 1; s < depths.size(); ++s)
+        {
+            for(state_type e = edge_starts[s]; e != edge_starts[s + 1]; ++e)
+            {
+                state_type t = edge_targets[e];
+                state_type f = next(fails[s], edge_labels[e]);
+                fails[t] = f;
+                outputs[t] = values_of[f] != none ? f : outputs[f];
+            }
+        }
+    }
+
+    state_type add_state(state_type depth)
+    {
+        if(depths.size() >= (size_type)none)
+        {
+            throw std::length_error("too many letters for the automaton");
+        }
+        depths.push_back(depth);
+        values_of.push_back(none);
+        return (state_type)(depths.size() - 1);
+    }
+
+    void add_edge(label_type label, state_type depth)
+    {
+        edge_labels.push_back(label);
+        edge_targets.push_back(add_state(depth + 1));
+    }
+
+    // state after reading letter i from state s, following failure links until a transition exists
+    state_type next(state_type s, label_type i) const noexcept
+    {
+        while(s != 0)
+        {
+            auto first = edge_labels.begin() + edge_starts[s];
+            auto last = edge_labels.begin() + edge_starts[s + 1];
+            auto it = std::lower_bound(first, last, i);
+            if(it != last && *it == i)
+            {
+                return edge_targets[it - edge_labels.begin()];
+            }
+            s = fails[s];
+        }
+        return root_next[i];
+    }
+
+    charset_type abc;
+    std::vector<state_type> edge_starts;   // first transition of each state, then the number of transitions
+    std::vector<label_type> edge_labels;
+    std::vector<state_type> edge_targets;
+    std::vector<state_type> fails;
+    std::vector<state_type> outputs;       // none when no proper suffix is a key
+    std::vector<state_type> depths;        // letters from the root
+    std::vector<state_type> values_of;     // index in values, none without value
+    std::vector<state_type> root_next;     // transitions of the root by letter, 0 when missing
+    std::vector<mapped_type> values;
+};
+
+#endif //PREFIX_TREE_AHO_CORASICK_SCANNER_H
@@ -0,0 +1,153 @@
+// Readers looking up and scanning keys while writers insert and erase disjoint keys, with a
+// concurrent_prefix_tree and with a prefix_tree behind a reader writer lock.
+// usage: concurrent_stress [readers] [writers] [seconds] [keys]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../charset.h"
+#include "../prefix_tree.h"
+#include "../concurrent_prefix_tree.h"
+
+namespace
+{
+    typedef std::size_t size_type;
+
+    std::string make_key(size_type i)
+    {
+        return "https://host" + std::to_string(i % 997) + ".example/path/" + std::to_string(i);
+    }
+
+    struct result
+    {
+        double reads;
+        double writes;
+        size_type found;    // keeps the lookups from being optimized away
+    };
+
+    template<class Read, class Write>
+    result run(size_type readers, size_type writers, double seconds, size_type keys, Read read, Write write)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<size_type> reads(0);
+        std::atomic<size_type> found(0);
+        std::vector<std::thread> threads;
+        for(size_type r = 0; r != readers; ++r)
+        {
+            threads.emplace_back([&, r]()
+            {
+                std::mt19937_64 random(r);
+                size_type n = 0;
+                size_type f = 0;
+                while(!stop.load(std::memory_order_relaxed))
+                {
+                    f += read(make_key(random() % (keys * 2)), n % 64 == 0);
+                    ++n;
+                }
+                reads += n;
+                found += f;
+            });
+        }
+        std::atomic<size_type> writes(0);
+        for(size_type w = 0; w != writers; ++w)
+        {
+            threads.emplace_back([&, w]()
+            {
+                std::mt19937_64 random(readers + w);
+                size_type n = 0;
+                while(!stop.load(std::memory_order_relaxed))
+                {
+                    size_type k = (random() % (keys * 2 / writers)) * writers + w;
+                    write(make_key(k), k, (random() & 1) != 0);
+                    ++n;
+                }
+                writes += n;
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for(std::thread & t : threads)
+        {
+            t.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result{reads / elapsed, writes / elapsed, found};
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    size_type readers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    size_type writers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 5.0;
+    size_type keys = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 1000000;
+
+    typedef concurrent_prefix_tree<std::string, size_type, ascii_charset> concurrent_tree;
+    concurrent_tree concurrent;
+    typedef prefix_tree<std::string, size_type, ascii_charset, string_prefixer_traits> locked_tree;
+    locked_tree locked;
+    std::shared_mutex lock;
+    for(size_type i = 0; i != keys; ++i)
+    {
+        concurrent.insert(make_key(i * 2), i * 2);
+        locked.insert(make_key(i * 2), i * 2);
+    }
+
+    result c = run(readers, writers, seconds, keys, [&](const std::string & key, bool scan) -> size_type
+    {
+        concurrent_tree::reader r = concurrent.read();
+        size_type n = 0;
+        if(scan)
+        {
+            for(concurrent_tree::const_iterator it = r.lower_bound(key); it != r.end() && n != 16; ++it, ++n);
+            return n;
+        }
+        return r.count(key);
+    }, [&](const std::string & key, size_type k, bool add)
+    {
+        if(add)
+        {
+            concurrent.insert_or_assign(key, k);
+        }
+        else
+        {
+            concurrent.erase(key);
+        }
+    });
+
+    result l = run(readers, writers, seconds, keys, [&](const std::string & key, bool scan) -> size_type
+    {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        size_type n = 0;
+        if(scan)
+        {
+            for(locked_tree::const_iterator it = locked.lower_bound(key); it != locked.cend() && n != 16; ++it, ++n);
+            return n;
+        }
+        return locked.count(key);
+    }, [&](const std::string & key, size_type k, bool add)
+    {
+        std::unique_lock<std::shared_mutex> guard(lock);
+        if(add)
+        {
+            locked[key] = k;
+        }
+        else
+        {
+            locked.erase(key);
+        }
+    });
+
+    std::cout << readers << " readers, " << writers << " writers, " << keys << " keys, " << seconds << "s" << std::endl;
+    std::cout << "concurrent_prefix_tree  reads/s " << c.reads << "  writes/s " << c.writes << "  found " << c.found << std::endl;
+    std::cout << "prefix_tree + lock      reads/s " << l.reads << "  writes/s " << l.writes << "  found " << l.found << std::endl;
+    return 0;
+}
@@ -5,6 +5,7 @@
 #ifndef PREFIX_TREE_CHARSET_H
 #define PREFIX_TREE_CHARSET_H
 
+#include<algorithm>
 #include<array>
 #include<iterator>
 #include<limits>
@@ -21,6 +22,7 @@ public:
 
     static constexpr size_type size = N;
     static constexpr size_type index_size = N;
+    static constexpr bool identity = true;
 
     inline index_type to_int_type(const letter_type & c) const noexcept
     {
@@ -0,0 +1,877 @@
+#ifndef PREFIX_TREE_CONCURRENT_PREFIX_TREE_H
+#define PREFIX_TREE_CONCURRENT_PREFIX_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util/epoch.h"
+#include "util/optimistic_lock.h"
+#include "util/mismatch.h"
+
+// Sub nodes of a concurrent node sorted by label, never resized once published: adding or removing
+// a sub node publishes a copy, replacing one stores the new node in its slot.
+// Layout: the table | one node slot per sub node | one label per sub node
+template<typename Node, typename Label>
+class child_table
+{
+public:
+    typedef std::size_t size_type;
+    typedef Node node_type;
+    typedef Label label_type;
+    typedef child_table<node_type, label_type> type;
+
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    static type * make(size_type count)
+    {
+        void * p = ::operator new(sizeof(type) + count * (sizeof(std::atomic<node_type *>) + sizeof(label_type)));
+        type * result = new(p) type(count);
+        for(size_type i = 0; i != count; ++i)
+        {
+            new((void *)(result->slots() + i)) std::atomic<node_type *>(nullptr);
+        }
+        return result;
+    }
+
+    static void destroy(void * p) noexcept
+    {
+        if(p)
+        {
+            ::operator delete(p);
+        }
+    }
+
+    // copy of table with n added as the sub node of label, table may be nullptr
+    static type * insert(const type * table, label_type label, node_type * n)
+    {
+        size_type count = table ? table->count : 0;
+        size_type position = table ? table->lower_bound(label) : 0;
+        type * result = make(count + 1);
+        for(size_type i = 0, j = 0; i != count + 1; ++i)
+        {
+            if(i == position)
+            {
+                result->labels()[i] = label;
+                result->slots()[i].store(n, std::memory_order_relaxed);
+            }
+            else
+            {
+                result->labels()[i] = table->labels()[j];
+                result->slots()[i].store(table->get(j), std::memory_order_relaxed);
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    // copy of table without its sub node at position, nullptr when none is left
+    static type * erase(const type * table, size_type position)
+    {
+        if(table->count == 1)
+        {
+            return nullptr;
+        }
+        type * result = make(table->count - 1);
+        for(size_type i = 0, j = 0; i != table->count; ++i)
+        {
+            if(i != position)
+            {
+                result->labels()[j] = table->labels()[i];
+                result->slots()[j].store(table->get(i), std::memory_order_relaxed);
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    size_type size() const noexcept
+    {
+        return count;
+    }
+
+    label_type label(size_type i) const noexcept
+    {
+        return labels()[i];
+    }
+
+    node_type * get(size_type i) const noexcept
+    {
+        return slots()[i].load(std::memory_order_acquire);
+    }
+
+    void set(size_type i, node_type * n) noexcept
+    {
+        slots()[i].store(n, std::memory_order_release);
+    }
+
+    // position of label, npos when absent
+    size_type find(label_type label) const noexcept
+    {
+        size_type i = lower_bound(label);
+        return i != count && labels()[i] == label ? i : npos;
+    }
+
+    // first position whose label is not less than label
+    size_type lower_bound(label_type label) const noexcept
+    {
+        return (size_type)(std::lower_bound(labels(), labels() + count, label) - labels());
+    }
+
+private:
+    explicit child_table(size_type count) noexcept
+    :count(count)
+    {
+    }
+
+    std::atomic<node_type *> * slots() const noexcept
+    {
+        return reinterpret_cast<std::atomic<node_type *> *>(const_cast<type *>(this) + 1);
+    }
+
+    label_type * labels() const noexcept
+    {
+        return reinterpret_cast<label_type *>(slots() + count);
+    }
+
+    size_type count;
+};
+
+// Node of a concurrent_prefix_tree. The prefix never changes once the node is published: a node whose
+// prefix has to change is replaced by a copy sharing its sub nodes and value.
+template<typename Key, typename Value, typename Label>
+struct concurrent_node
+{
+    typedef concurrent_node<Key, Value, Label> type;
+    typedef child_table<type, Label> table_type;
+
+    concurrent_node(Key && prefix, table_type * children, Value * value) noexcept
+    :prefix(std::move(prefix))
+    ,children(children)
+    ,value(value)
+    {
+    }
+
+    const Key prefix;
+    std::atomic<table_type *> children;     // nullptr for a leaf
+    std::atomic<Value *> value;
+    optimistic_lock lock;                   // taken by writers changing the sub nodes or the value
+};
+
+template <typename Tree>
+class concurrent_prefix_tree_iterator
+{
+public:
+    typedef Tree tree_type;
+    typedef concurrent_prefix_tree_iterator<tree_type> type;
+    typedef typename tree_type::key_type key_type;
+    typedef typename tree_type::mapped_type mapped_type;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::node_type node_type;
+    typedef typename tree_type::table_type table_type;
+
+    typedef std::forward_iterator_tag iterator_category;
+    typedef mapped_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const mapped_type * pointer;
+    typedef const mapped_type & reference;
+
+    // end iterator
+    concurrent_prefix_tree_iterator() noexcept
+    :tree(nullptr)
+    ,current(nullptr)
+    {
+    }
+
+    // first entry of the sub tree of n whose key is key, iteration stops when leaving it
+    concurrent_prefix_tree_iterator(const tree_type * tree, const node_type * n, key_type && key)
+    :tree(tree)
+    ,key_buffer(std::move(key))
+    ,current(nullptr)
+    {
+        if(n)
+        {
+            push(n);
+            settle();
+        }
+    }
+
+    reference operator*() const noexcept
+    {
+        return *current;
+    }
+
+    pointer operator->() const noexcept
+    {
+        return current;
+    }
+
+    const key_type & key() const noexcept
+    {
+        return key_buffer;
+    }
+
+    reference value() const noexcept
+    {
+        return *current;
+    }
+
+    bool operator ==(const type & right) const noexcept
+    {
+        return top() == right.top();
+    }
+
+    bool operator !=(const type & right) const noexcept
+    {
+        return top() != right.top();
+    }
+
+    // next entry in key order. Entries added or removed meanwhile may or may not be seen.
+    type & operator++()
+    {
+        advance();
+        settle();
+        return *this;
+    }
+
+private:
+    friend tree_type;
+
+    struct frame
+    {
+        const node_type * n;
+        const table_type * children;    // as loaded when the node was entered
+        size_type next;                 // next sub node to visit
+    };
+
+    const node_type * top() const noexcept
+    {
+        return frames.empty() ? nullptr : frames.back().n;
+    }
+
+    void push(const node_type * n)
+    {
+        frames.push_back(frame{n, n->children.load(std::memory_order_acquire), 0});
+    }
+
+    // stop on the current node when it holds a value, move to the next one holding a value otherwise
+    void settle()
+    {
+        while(!frames.empty())
+        {
+            current = frames.back().n->value.load(std::memory_order_acquire);
+            if(current)
+            {
+                return;
+            }
+            advance();
+        }
+        current = nullptr;
+    }
+
+    // next node in DFS order, whether it holds a value or not
+    void advance()
+    {
+        while(!frames.empty())
+        {
+            frame & f = frames.back();
+            if(f.children && f.next != f.children->size())
+            {
+                size_type i = f.next++;
+                const node_type * child = f.children->get(i);
+                key_buffer.push_back(tree->abc.to_char_type(f.children->label(i)));
+                key_buffer.append(child->prefix);
+                push(child);
+                return;
+            }
+            size_type length = f.n->prefix.size() + 1;
+            frames.pop_back();
+            if(!frames.empty())
+            {
+                key_buffer.resize(key_buffer.size() - length);
+            }
+        }
+    }
+
+    const tree_type * tree;
+    std::vector<frame> frames;      // from the first node of the range to the current one
+    key_type key_buffer;
+    const mapped_type * current;
+};
+
+// Prefix tree read and written by any number of threads. Sub node tables and prefixes are immutable once
+// published: a writer publishes a new table, node or value with an atomic store, and retires what it
+// replaced to an epoch_manager. Splitting a node replaces it by a node holding the common part whose sub
+// node is a copy of the old one with the end of its prefix; merging a node with its single sub node
+// replaces both by a copy of the sub node.
+// Readers take no lock and never wait, they go through a reader which pins the epoch for as long as it and
+// its iterators are used. Writers use optimistic lock coupling: they go down without locking, reading the
+// version of each node, then lock only the nodes they change by upgrading the versions they read, and
+// start again when one changed meanwhile.
+template<class K, class T, class Charset>
+class concurrent_prefix_tree
+{
+public:
+    typedef std::size_t size_type;
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef Charset charset_type;
+    typedef concurrent_prefix_tree<key_type, mapped_type, charset_type> type;
+    typedef mapped_type value_type;
+
+    typedef typename charset_type::letter_type letter_type;
+    typedef typename key_type::const_iterator key_const_iterator;
+    typedef typename std::conditional<(charset_type::size <= 256), std::uint8_t, std::uint32_t>::type label_type;
+    typedef concurrent_node<key_type, mapped_type, label_type> node_type;
+    typedef typename node_type::table_type table_type;
+
+    typedef concurrent_prefix_tree_iterator<type> const_iterator;
+    typedef const_iterator iterator;
+    friend const_iterator;
+
+    // lookups pinning the epoch of the tree, results stay valid as long as the reader lives
+    class reader
+    {
+    public:
+        explicit reader(const type & tree)
+        :tree(&tree)
+        ,guard(tree.epochs.pin())
+        {
+        }
+
+        const_iterator find(const key_type & key) const
+        {
+            const_iterator result = lower_bound(key);
+            return result != end() && result.key() == key ? result : end();
+        }
+
+        // value of key, nullptr when absent
+        const mapped_type * get(const key_type & key) const
+        {
+            const node_type * n = tree->exact_node(key);
+            return n ? n->value.load(std::memory_order_acquire) : nullptr;
+        }
+
+        size_type count(const key_type & key) const
+        {
+            return get(key) ? 1 : 0;
+        }
+
+        const_iterator lower_bound(const key_type & key) const
+        {
+            return tree->lower_bound(key);
+        }
+
+        const_iterator upper_bound(const key_type & key) const
+        {
+            const_iterator result = lower_bound(key);
+            if(result != end() && result.key() == key)
+            {
+                ++result;
+            }
+            return result;
+        }
+
+        // entries whose key starts with prefix
+        std::pair<const_iterator, const_iterator> equal_prefix_range(const key_type & prefix) const
+        {
+            return std::make_pair(tree->prefix_begin(prefix), end());
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(tree, tree->root, key_type());
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator();
+        }
+
+    private:
+        const type * tree;
+        epoch_guard guard;
+    };
+
+    explicit concurrent_prefix_tree(const charset_type & abc = charset_type(), size_type reader_slots = 256)
+    :abc(abc)
+    ,epochs(reader_slots)
+    ,root(new node_type(key_type(), nullptr, nullptr))
+    ,entries(0)
+    {
+    }
+
+    concurrent_prefix_tree(const concurrent_prefix_tree &) = delete;
+    concurrent_prefix_tree & operator=(const concurrent_prefix_tree &) = delete;
+
+    // no reader may be alive
+    ~concurrent_prefix_tree() noexcept
+    {
+        destroy(root);
+    }
+
+    reader read() const
+    {
+        return reader(*this);
+    }
+
+    // insert value for key, false when key already has a value which is kept
+    bool insert(const key_type & key, const mapped_type & value)
+    {
+        std::unique_ptr<mapped_type> v(new mapped_type(value));
+        epoch_guard guard = epochs.pin();
+        while(true)
+        {
+            lock_set locks;
+            node_type * n = lock_node(key, locks);
+            if(n)
+            {
+                if(n->value.load(std::memory_order_relaxed))
+                {
+                    return false;
+                }
+                n->value.store(v.release(), std::memory_order_release);
+                entries.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    // set the value of key, false when it replaces a value which is retired
+    bool insert_or_assign(const key_type & key, const mapped_type & value)
+    {
+        std::unique_ptr<mapped_type> v(new mapped_type(value));
+        epoch_guard guard = epochs.pin();
+        while(true)
+        {
+            lock_set locks;
+            node_type * n = lock_node(key, locks);
+            if(n)
+            {
+                mapped_type * previous = n->value.exchange(v.release(), std::memory_order_acq_rel);
+                if(previous)
+                {
+                    epochs.retire(previous);
+                    return false;
+                }
+                entries.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    size_type erase(const key_type & key)
+    {
+        epoch_guard guard = epochs.pin();
+        while(true)
+        {
+            lock_set locks;
+            int result = try_erase(key, locks);
+            if(result >= 0)
+            {
+                return (size_type)result;
+            }
+        }
+    }
+
+    size_type size() const noexcept
+    {
+        return entries.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+private:
+    typedef optimistic_lock::version_type version_type;
+
+    // nodes locked by a writer, unlocked when it goes out of scope
+    class lock_set
+    {
+    public:
+        lock_set() noexcept
+        :count(0)
+        {
+        }
+
+        lock_set(const lock_set &) = delete;
+        lock_set & operator=(const lock_set &) = delete;
+
+        ~lock_set() noexcept
+        {
+            for(size_type i = 0; i != count; ++i)
+            {
+                if(unlinked[i])
+                {
+                    nodes[i]->lock.unlock_obsolete();
+                }
+                else
+                {
+                    nodes[i]->lock.unlock();
+                }
+            }
+        }
+
+        // lock n if it did not change since version v was read
+        bool add(node_type * n, version_type v) noexcept
+        {
+            if(!n->lock.try_upgrade(v))
+            {
+                return false;
+            }
+            nodes[count] = n;
+            unlinked[count] = false;
+            ++count;
+            return true;
+        }
+
+        // n, locked by this set, is being unlinked
+        void unlink(node_type * n) noexcept
+        {
+            for(size_type i = 0; i != count; ++i)
+            {
+                unlinked[i] = unlinked[i] || nodes[i] == n;
+            }
+        }
+
+    private:
+        node_type * nodes[4];
+        bool unlinked[4];
+        size_type count;
+    };
+
+    // node of key locked by locks, created or split as needed. nullptr when another writer changed a node
+    // on the way, the caller releases its locks and starts again.
+    node_type * lock_node(const key_type & key, lock_set & locks)
+    {
+        node_type * n = root;
+        version_type v = n->lock.read();
+        key_const_iterator start = key.begin();
+        key_const_iterator last = key.end();
+        while(start != last)
+        {
+            label_type label = (label_type)abc.to_int_type(*start);
+            table_type * children = n->children.load(std::memory_order_acquire);
+            size_type i = children ? children->find(label) : table_type::npos;
+            if(i == table_type::npos)
+            {
+                return locks.add(n, v) ? add_leaf(n, key, start, locks) : nullptr;
+            }
+
+            node_type * child = children->get(i);
+            version_type child_version = child->lock.read();
+            if(!n->lock.validate(v))
+            {
+                return nullptr;
+            }
+            ++start;
+            key_const_iterator pi = child->prefix.begin();
+            key_const_iterator pend = child->prefix.end();
+            match_prefix(abc, pi, pend, start, last);
+            if(pi != pend) // split child, the letter at pi becomes the label of its copy
+            {
+                if(!locks.add(n, v) || !locks.add(child, child_version))
+                {
+                    return nullptr;
+                }
+                std::unique_ptr<node_type> lower(new node_type(key_type(pi + 1, pend), child->children.load(std::memory_order_relaxed), child->value.load(std::memory_order_relaxed)));
+                table_type * table = table_type::insert(nullptr, (label_type)abc.to_int_type(*pi), lower.get());
+                node_type * middle;
+                try
+                {
+                    middle = new node_type(key_type(child->prefix.begin(), pi), table, nullptr);
+                }
+                catch(...)
+                {
+                    table_type::destroy(table);
+                    throw;
+                }
+                lower.release();
+                locks.add(middle, middle->lock.read());
+                children->set(i, middle);
+                locks.unlink(child);
+                epochs.retire(child);
+                return start == last ? middle : add_leaf(middle, key, start, locks);
+            }
+            n = child;
+            v = child_version;
+        }
+        return locks.add(n, v) ? n : nullptr;
+    }
+
+    // link a leaf for the letters of key from start below n, which is locked. The leaf is locked before it is published.
+    node_type * add_leaf(node_type * n, const key_type & key, key_const_iterator start, lock_set & locks)
+    {
+        label_type label = (label_type)abc.to_int_type(*start);
+        ++start;
+        table_type * children = n->children.load(std::memory_order_relaxed);
+        std::unique_ptr<node_type> leaf(new node_type(key_type(start, key.end()), nullptr, nullptr));
+        table_type * table = table_type::insert(children, label, leaf.get());
+        locks.add(leaf.get(), leaf->lock.read());
+        n->children.store(table, std::memory_order_release);
+        if(children)
+        {
+            epochs.retire(children, &table_type::destroy);
+        }
+        return leaf.release();
+    }
+
+    // remove the value of key: 1 when removed, 0 when key has no value, -1 when another writer changed a
+    // node on the way and the caller has to start again
+    int try_erase(const key_type & key, lock_set & locks)
+    {
+        // the last nodes of the path with their version and position in the table of their parent
+        struct step
+        {
+            node_type * n;
+            version_type v;
+            size_type slot;
+        };
+        step grand_parent{nullptr, 0, 0};
+        step parent{nullptr, 0, 0};
+        step current{root, root->lock.read(), 0};
+
+        key_const_iterator start = key.begin();
+        key_const_iterator last = key.end();
+        while(start != last)
+        {
+            table_type * children = current.n->children.load(std::memory_order_acquire);
+            size_type i = children ? children->find((label_type)abc.to_int_type(*start)) : table_type::npos;
+            if(i == table_type::npos)
+            {
+                return current.n->lock.validate(current.v) ? 0 : -1;
+            }
+            node_type * child = children->get(i);
+            version_type child_version = child->lock.read();
+            if(!current.n->lock.validate(current.v))
+            {
+                return -1;
+            }
+            ++start;
+            key_const_iterator pi = child->prefix.begin();
+            match_prefix(abc, pi, child->prefix.end(), start, last);
+            if(pi != child->prefix.end())
+            {
+                return 0;
+            }
+            grand_parent = parent;
+            parent = current;
+            current = step{child, child_version, i};
+        }
+
+        node_type * n = current.n;
+        table_type * children = n->children.load(std::memory_order_acquire);
+        bool has_value = n->value.load(std::memory_order_acquire) != nullptr;
+        if(!n->lock.validate(current.v))
+        {
+            return -1;
+        }
+        if(!has_value)
+        {
+            return 0;
+        }
+
+        if(n == root || (children && children->size() > 1))
+        {
+            if(!locks.add(n, current.v))
+            {
+                return -1;
+            }
+            take_value(n);
+        }
+        else if(children) // n is joined with its single sub node
+        {
+            node_type * child = children->get(0);
+            version_type child_version = child->lock.read();
+            if(!n->lock.validate(current.v) || !locks.add(parent.n, parent.v) || !locks.add(n, current.v) || !locks.add(child, child_version))
+            {
+                return -1;
+            }
+            take_value(n);
+            merge(n, parent.n->children.load(std::memory_order_relaxed), current.slot);
+            locks.unlink(n);
+            locks.unlink(child);
+        }
+        else // n is unlinked, its parent is joined with its other sub node when it is left alone without value
+        {
+            table_type * table = parent.n->children.load(std::memory_order_acquire);
+            bool join = parent.n != root && table->size() == 2 && !parent.n->value.load(std::memory_order_acquire);
+            node_type * sibling = join ? table->get(1 - current.slot) : nullptr;
+            version_type sibling_version = join ? sibling->lock.read() : 0;
+            if(!parent.n->lock.validate(parent.v)
+               || (join && !locks.add(grand_parent.n, grand_parent.v))
+               || !locks.add(parent.n, parent.v)
+               || !locks.add(n, current.v)
+               || (join && !locks.add(sibling, sibling_version)))
+            {
+                return -1;
+            }
+            take_value(n);
+            table_type * remaining = table_type::erase(table, current.slot);
+            parent.n->children.store(remaining, std::memory_order_release);
+            epochs.retire(table, &table_type::destroy);
+            locks.unlink(n);
+            epochs.retire(n);
+            if(join)
+            {
+                merge(parent.n, grand_parent.n->children.load(std::memory_order_relaxed), parent.slot);
+                locks.unlink(parent.n);
+                locks.unlink(sibling);
+            }
+        }
+        return 1;
+    }
+
+    void take_value(node_type * n)
+    {
+        epochs.retire(n->value.exchange(nullptr, std::memory_order_acq_rel));
+        entries.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // replace n, which has a single sub node and no value, by a copy of the sub node with their joined prefix.
+    // n is linked at slot of table.
+    void merge(node_type * n, table_type * table, size_type slot)
+    {
+        table_type * children = n->children.load(std::memory_order_relaxed);
+        node_type * child = children->get(0);
+        key_type prefix;
+        prefix.reserve(n->prefix.size() + 1 + child->prefix.size());
+        prefix.append(n->prefix);
+        prefix.push_back(abc.to_char_type(children->label(0)));
+        prefix.append(child->prefix);
+        node_type * joined = new node_type(std::move(prefix), child->children.load(std::memory_order_relaxed), child->value.load(std::memory_order_relaxed));
+        table->set(slot, joined);
+        epochs.retire(n);
+        epochs.retire(children, &table_type::destroy);
+        epochs.retire(child);
+    }
+
+    // node holding the value of key, nullptr when key is not a node
+    const node_type * exact_node(const key_type & key) const
+    {
+        const node_type * n = root;
+        key_const_iterator start = key.begin();
+        key_const_iterator last = key.end();
+        while(start != last)
+        {
+            const table_type * children = n->children.load(std::memory_order_acquire);
+            size_type i = children ? children->find((label_type)abc.to_int_type(*start)) : table_type::npos;
+            if(i == table_type::npos)
+            {
+                return nullptr;
+            }
+            n = children->get(i);
+            ++start;
+            key_const_iterator pi = n->prefix.begin();
+            match_prefix(abc, pi, n->prefix.end(), start, last);
+            if(pi != n->prefix.end())
+            {
+                return nullptr;
+            }
+        }
+        return n;
+    }
+
+    // first entry of the sub tree prefix ends in
+    const_iterator prefix_begin(const key_type & prefix) const
+    {
+        const node_type * n = root;
+        key_type path;
+        key_const_iterator start = prefix.begin();
+        key_const_iterator last = prefix.end();
+        while(start != last)
+        {
+            const table_type * children = n->children.load(std::memory_order_acquire);
+            size_type i = children ? children->find((label_type)abc.to_int_type(*start)) : table_type::npos;
+            if(i == table_type::npos)
+            {
+                return const_iterator();
+            }
+            n = children->get(i);
+            ++start;
+            key_const_iterator pi = n->prefix.begin();
+            match_prefix(abc, pi, n->prefix.end(), start, last);
+            if(pi != n->prefix.end() && start != last)
+            {
+                return const_iterator();
+            }
+            path.push_back(abc.to_char_type(children->label(i)));
+            path.append(n->prefix);
+        }
+        return const_iterator(this, n, std::move(path));
+    }
+
+    // first entry whose key is not less than key
+    const_iterator lower_bound(const key_type & key) const
+    {
+        const_iterator result(this, nullptr, key_type());
+        result.push(root);
+        key_const_iterator start = key.begin();
+        key_const_iterator last = key.end();
+        while(true)
+        {
+            typename const_iterator::frame & f = result.frames.back();
+            if(start == last) // every entry of the sub tree is greater or equal
+            {
+                break;
+            }
+            label_type label = (label_type)abc.to_int_type(*start);
+            size_type i = f.children ? f.children->lower_bound(label) : 0;
+            f.next = i;
+            if(!f.children || i == f.children->size() || f.children->label(i) != label)
+            {
+                // the value of the node is less, the sub nodes from i are greater
+                result.advance();
+                break;
+            }
+            ++start;
+            result.advance(); // enter the sub node of label
+            const node_type * child = result.frames.back().n;
+            key_const_iterator pi = child->prefix.begin();
+            key_const_iterator pend = child->prefix.end();
+            match_prefix(abc, pi, pend, start, last);
+            if(pi != pend)
+            {
+                if(start != last && abc.to_int_type(*pi) < abc.to_int_type(*start)) // the whole sub tree is less
+                {
+                    result.frames.back().next = result.frames.back().children ? result.frames.back().children->size() : 0;
+                    result.advance();
+                }
+                break;
+            }
+        }
+        result.settle();
+        return result;
+    }
+
+    static void destroy(node_type * n) noexcept
+    {
+        table_type * children = n->children.load(std::memory_order_relaxed);
+        if(children)
+        {
+            for(size_type i = 0; i != children->size(); ++i)
+            {
+                destroy(children->get(i));
+            }
+            table_type::destroy(children);
+        }
+        delete n->value.load(std::memory_order_relaxed);
+        delete n;
+    }
+
+    const charset_type abc;
+    mutable epoch_manager epochs;
+    node_type * const root;
+    std::atomic<size_type> entries;
+};
+
+#endif //PREFIX_TREE_CONCURRENT_PREFIX_TREE_H
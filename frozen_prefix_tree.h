@@ -0,0 +1,540 @@
+#ifndef PREFIX_TREE_FROZEN_PREFIX_TREE_H
+#define PREFIX_TREE_FROZEN_PREFIX_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util/mapped_file.h"
+#include "util/mismatch.h"
+
+// Flat layout written by prefix_tree::freeze and read in place by frozen_prefix_tree. Nodes refer to
+// each other by their index, so the file can be mapped anywhere:
+// header | nodes in DFS order | child labels | child node indexes | prefix letters | node of each value | values
+// Child tables and values are in key order. Sections are 8 bytes aligned (values on their own alignment
+// when larger) and integers are in native byte order.
+struct frozen_header
+{
+    typedef std::uint64_t size_type;
+
+    static constexpr std::uint32_t current_version = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t letter_size;
+    std::uint32_t value_size;
+    std::uint32_t value_alignment;
+    size_type node_count;
+    size_type child_count;
+    size_type letter_count;
+    size_type value_count;
+    // offsets of the sections from the start of the file
+    size_type nodes;
+    size_type labels;
+    size_type children;
+    size_type letters;
+    size_type value_nodes;
+    size_type values;
+    size_type size;
+
+    static const char * signature() noexcept
+    {
+        return "PTFROZEN";
+    }
+
+    template<typename Letter, typename Value>
+    static frozen_header make(size_type node_count, size_type letter_count, size_type value_count);
+
+    template<typename Letter, typename Value>
+    bool matches(size_type file_size) const noexcept
+    {
+        return std::memcmp(magic, signature(), sizeof(magic)) == 0
+               && version == current_version
+               && letter_size == sizeof(Letter)
+               && value_size == sizeof(Value)
+               && value_alignment == alignof(Value)
+               && size == file_size
+               && node_count != 0;
+    }
+};
+
+struct frozen_node
+{
+    typedef std::uint64_t size_type;
+
+    size_type prefix;           // first letter of the prefix in the letters section
+    size_type child_table;      // first entry of the sub nodes in the child tables
+    size_type parent;           // node_count for the root
+    size_type rank;             // number of values held by the nodes before this one
+    size_type end;              // index following the last node of the sub tree
+    std::uint32_t prefix_length;
+    std::uint32_t child_count;
+    std::uint32_t label;        // charset index of the node in its parent
+    std::uint32_t has_value;
+};
+
+template<typename Letter, typename Value>
+frozen_header frozen_header::make(size_type node_count, size_type letter_count, size_type value_count)
+{
+    auto align = [](size_type offset, size_type alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    };
+    frozen_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, signature(), sizeof(header.magic));
+    header.version = current_version;
+    header.letter_size = sizeof(Letter);
+    header.value_size = sizeof(Value);
+    header.value_alignment = alignof(Value);
+    header.node_count = node_count;
+    header.child_count = node_count - 1;
+    header.letter_count = letter_count;
+    header.value_count = value_count;
+    header.nodes = align(sizeof(frozen_header), 8);
+    header.labels = align(header.nodes + node_count * sizeof(frozen_node), 8);
+    header.children = align(header.labels + header.child_count * sizeof(std::uint32_t), 8);
+    header.letters = align(header.children + header.child_count * sizeof(size_type), 8);
+    header.value_nodes = align(header.letters + letter_count * sizeof(Letter), 8);
+    header.values = align(header.value_nodes + value_count * sizeof(size_type), std::max<size_type>(8, alignof(Value)));
+    header.size = header.values + value_count * sizeof(Value);
+    return header;
+}
+
+// Writes the tree below root in the frozen layout, in two passes: one to size the file, one filling its mapping.
+template<typename Node>
+struct freezer
+{
+    typedef Node node_type;
+    typedef freezer<node_type> type;
+    typedef std::uint64_t size_type;
+    typedef typename node_type::charset_type::letter_type letter_type;
+    typedef typename node_type::value_type mapped_type;
+    typedef typename node_type::storage_type storage_type;
+    typedef typename node_type::const_iterator child_iterator;
+
+    static void freeze(const node_type * root, const std::string & path)
+    {
+        static_assert(std::is_trivially_copyable<mapped_type>::value, "frozen values are read in place from the file");
+
+        size_type node_count = 0;
+        size_type letter_count = 0;
+        std::vector<const node_type *> pending(1, root);
+        while(!pending.empty())
+        {
+            const node_type * n = pending.back();
+            pending.pop_back();
+            ++node_count;
+            letter_count += std::distance(n->prefix_begin(), n->prefix_end());
+            for(child_iterator it = n->begin(), last = n->end(); it != last; ++it)
+            {
+                pending.push_back(*it);
+            }
+        }
+
+        frozen_header header = frozen_header::make<letter_type, mapped_type>(node_count, letter_count, root->subtree_size());
+        mapped_file file = mapped_file::create(path, header.size);
+        char * base = file.data();
+        std::memcpy(base, &header, sizeof(header));
+
+        type writer(base, header);
+        std::vector<frame> stack;
+        stack.push_back(writer.visit(root, node_count, 0));
+        while(!stack.empty())
+        {
+            frame & top = stack.back();
+            if(top.it != top.node->end())
+            {
+                const node_type * child = *top.it;
+                std::uint32_t label = (std::uint32_t)top.it.index();
+                size_type slot = top.slot++;
+                size_type parent = top.index;
+                ++top.it;
+
+                writer.labels[slot] = label;
+                frame next = writer.visit(child, parent, label);
+                writer.children[slot] = next.index;
+                stack.push_back(next);
+            }
+            else
+            {
+                writer.nodes[top.index].end = writer.next_node;
+                stack.pop_back();
+            }
+        }
+    }
+
+private:
+    struct frame
+    {
+        const node_type * node;
+        child_iterator it;
+        size_type index;
+        size_type slot;
+    };
+
+    freezer(char * base, const frozen_header & header) noexcept
+    :nodes(reinterpret_cast<frozen_node *>(base + header.nodes))
+    ,labels(reinterpret_cast<std::uint32_t *>(base + header.labels))
+    ,children(reinterpret_cast<size_type *>(base + header.children))
+    ,letters(reinterpret_cast<letter_type *>(base + header.letters))
+    ,value_nodes(reinterpret_cast<size_type *>(base + header.value_nodes))
+    ,values(base + header.values)
+    ,next_node(0)
+    ,next_child(0)
+    ,next_letter(0)
+    ,next_value(0)
+    {
+    }
+
+    // write n as the next node in DFS order
+    frame visit(const node_type * n, size_type parent, std::uint32_t label)
+    {
+        size_type index = next_node++;
+        frozen_node & f = nodes[index];
+        f.prefix = next_letter;
+        f.prefix_length = (std::uint32_t)std::distance(n->prefix_begin(), n->prefix_end());
+        f.child_table = next_child;
+        f.child_count = (std::uint32_t)n->nb_sub_node();
+        f.parent = parent;
+        f.rank = next_value;
+        f.end = index + 1;
+        f.label = label;
+        f.has_value = n->get_value() ? 1 : 0;
+
+        next_letter = std::copy(n->prefix_begin(), n->prefix_end(), letters + next_letter) - letters;
+        next_child += f.child_count;
+        if(f.has_value)
+        {
+            value_nodes[next_value] = index;
+            std::memcpy(values + next_value * sizeof(mapped_type), &storage_type::value(*n->get_value()), sizeof(mapped_type));
+            ++next_value;
+        }
+        return frame{n, n->begin(), index, f.child_table};
+    }
+
+    frozen_node * nodes;
+    std::uint32_t * labels;
+    size_type * children;
+    letter_type * letters;
+    size_type * value_nodes;
+    char * values;
+    size_type next_node;
+    size_type next_child;
+    size_type next_letter;
+    size_type next_value;
+};
+
+template <typename Tree>
+class frozen_prefix_tree_iterator
+{
+public:
+    typedef Tree tree_type;
+    typedef frozen_prefix_tree_iterator<tree_type> type;
+    typedef typename tree_type::key_type key_type;
+    typedef typename tree_type::mapped_type mapped_type;
+    typedef std::uint64_t size_type;
+
+    typedef std::forward_iterator_tag iterator_category;
+    typedef mapped_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const mapped_type * pointer;
+    typedef const mapped_type & reference;
+
+    frozen_prefix_tree_iterator(const tree_type * tree, size_type position) noexcept
+    :tree(tree)
+    ,position(position)
+    {
+    }
+
+    reference operator*() const noexcept
+    {
+        return tree->value_at(position);
+    }
+
+    pointer operator->() const noexcept
+    {
+        return &tree->value_at(position);
+    }
+
+    // rebuilt from the path of the entry in a buffer owned by the iterator
+    const key_type & key() const
+    {
+        buffer.clear();
+        tree->append_key(buffer, tree->node_of(position));
+        return buffer;
+    }
+
+    reference value() const noexcept
+    {
+        return tree->value_at(position);
+    }
+
+    bool operator ==(const type & right) const noexcept
+    {
+        return position == right.position;
+    }
+
+    bool operator !=(const type & right) const noexcept
+    {
+        return position != right.position;
+    }
+
+    type & operator++() noexcept
+    {
+        ++position;
+        return *this;
+    }
+
+    // rank of the entry
+    size_type get_position() const noexcept
+    {
+        return position;
+    }
+
+private:
+    const tree_type * tree;
+    size_type position;
+    mutable key_type buffer;
+};
+
+// Read only prefix tree answering straight from a file written by prefix_tree::freeze, mapped in memory.
+// Nothing is deserialized: lookups walk the nodes of the mapping and iterators go through the values,
+// stored in key order. The mapped type must be the one of the frozen tree.
+template<class K, class T, class Charset>
+class frozen_prefix_tree
+{
+public:
+    typedef std::uint64_t size_type;
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef Charset charset_type;
+    typedef frozen_prefix_tree<key_type, mapped_type, charset_type> type;
+    typedef mapped_type value_type;
+
+    typedef typename charset_type::letter_type letter_type;
+    typedef typename key_type::const_iterator key_const_iterator;
+
+    typedef frozen_prefix_tree_iterator<type> const_iterator;
+    typedef const_iterator iterator;
+    friend const_iterator;
+
+    explicit frozen_prefix_tree(const std::string & path, const charset_type & abc = charset_type())
+    :abc(abc)
+    ,file(mapped_file::open(path))
+    {
+        const frozen_header * header = reinterpret_cast<const frozen_header *>(file.data());
+        if(file.size() < sizeof(frozen_header) || !header->template matches<letter_type, mapped_type>(file.size()))
+        {
+            throw std::runtime_error("not a frozen prefix tree of this type: " + path);
+        }
+        const char * base = file.data();
+        node_count = header->node_count;
+        value_count = header->value_count;
+        nodes = reinterpret_cast<const frozen_node *>(base + header->nodes);
+        labels = reinterpret_cast<const std::uint32_t *>(base + header->labels);
+        children = reinterpret_cast<const size_type *>(base + header->children);
+        letters = reinterpret_cast<const letter_type *>(base + header->letters);
+        value_nodes = reinterpret_cast<const size_type *>(base + header->value_nodes);
+        values = reinterpret_cast<const mapped_type *>(base + header->values);
+    }
+
+    frozen_prefix_tree(const frozen_prefix_tree &) = delete;
+    frozen_prefix_tree & operator=(const frozen_prefix_tree &) = delete;
+
+    const mapped_type & at(const key_type & key) const
+    {
+        const_iterator it = find(key);
+        if(it == end())
+        {
+            throw std::out_of_range("key not found");
+        }
+        return *it;
+    }
+
+    const_iterator find(const key_type & key) const
+    {
+        key_const_iterator start = key.begin();
+        key_const_iterator last = key.end();
+        size_type node;
+        const letter_type * pi;
+        locate(node, pi, start, last);
+        const frozen_node & n = nodes[node];
+        bool found = start == last && pi == letters + n.prefix + n.prefix_length && n.has_value;
+        return const_iterator(this, found ? n.rank : value_count);
+    }
+
+    size_type count(const key_type & key) const
+    {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    // first entry whose key is not less than key
+    const_iterator lower_bound(const key_type & key) const
+    {
+        return const_iterator(this, lower_rank(key));
+    }
+
+    // first entry whose key is greater than key
+    const_iterator upper_bound(const key_type & key) const
+    {
+        const_iterator result = lower_bound(key);
+        if(result != end() && result.key() == key)
+        {
+            ++result;
+        }
+        return result;
+    }
+
+    // entries whose key starts with prefix, the values of the sub tree the prefix ends in
+    std::pair<const_iterator, const_iterator> equal_prefix_range(const key_type & prefix) const
+    {
+        key_const_iterator start = prefix.begin();
+        key_const_iterator last = prefix.end();
+        size_type node;
+        const letter_type * pi;
+        locate(node, pi, start, last);
+        if(start != last)
+        {
+            return std::make_pair(end(), end());
+        }
+        return std::make_pair(const_iterator(this, nodes[node].rank), const_iterator(this, rank_at(nodes[node].end)));
+    }
+
+    size_type count_prefix(const key_type & prefix) const
+    {
+        std::pair<const_iterator, const_iterator> range = equal_prefix_range(prefix);
+        return range.second.get_position() - range.first.get_position();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(this, value_count);
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return const_iterator(this, value_count);
+    }
+
+    size_type size() const noexcept
+    {
+        return value_count;
+    }
+
+    bool empty() const noexcept
+    {
+        return value_count == 0;
+    }
+
+private:
+    // walk [start, last) from the root: node is the last node reached and pi the end of the match in its prefix
+    void locate(size_type & node, const letter_type * & pi, key_const_iterator & start, key_const_iterator last) const
+    {
+        node = 0;
+        while(true)
+        {
+            const frozen_node & n = nodes[node];
+            pi = letters + n.prefix;
+            const letter_type * pend = pi + n.prefix_length;
+            match_prefix(abc, pi, pend, start, last);
+            if(pi != pend || start == last)
+            {
+                return;
+            }
+            size_type child = child_of(n, (std::uint32_t)abc.to_int_type(*start));
+            if(child == node_count)
+            {
+                return;
+            }
+            ++start;
+            node = child;
+        }
+    }
+
+    size_type child_of(const frozen_node & n, std::uint32_t label) const noexcept
+    {
+        const std::uint32_t * first = labels + n.child_table;
+        const std::uint32_t * last = first + n.child_count;
+        const std::uint32_t * it = std::lower_bound(first, last, label);
+        return it != last && *it == label ? children[it - labels] : node_count;
+    }
+
+    size_type lower_rank(const key_type & key) const
+    {
+        key_const_iterator start = key.begin();
+        key_const_iterator last = key.end();
+        size_type node;
+        const letter_type * pi;
+        locate(node, pi, start, last);
+        const frozen_node & n = nodes[node];
+        if(pi != letters + n.prefix + n.prefix_length) // the whole sub tree is either less or greater than the key
+        {
+            return start != last && abc.to_int_type(*pi) < abc.to_int_type(*start) ? rank_at(n.end) : n.rank;
+        }
+        if(start == last)
+        {
+            return n.rank;
+        }
+        // no sub node for the next letter: first sub node after it or past the sub tree
+        const std::uint32_t * first = labels + n.child_table;
+        const std::uint32_t * child_last = first + n.child_count;
+        const std::uint32_t * it = std::upper_bound(first, child_last, (std::uint32_t)abc.to_int_type(*start));
+        return it != child_last ? nodes[children[it - labels]].rank : rank_at(n.end);
+    }
+
+    size_type rank_at(size_type node) const noexcept
+    {
+        return node == node_count ? value_count : nodes[node].rank;
+    }
+
+    size_type node_of(size_type position) const noexcept
+    {
+        return value_nodes[position];
+    }
+
+    const mapped_type & value_at(size_type position) const noexcept
+    {
+        return values[position];
+    }
+
+    void append_key(key_type & key, size_type node) const
+    {
+        const frozen_node & n = nodes[node];
+        if(n.parent != node_count)
+        {
+            append_key(key, n.parent);
+            key.push_back(abc.to_char_type(n.label));
+        }
+        key.append(letters + n.prefix, letters + n.prefix + n.prefix_length);
+    }
+
+    const charset_type abc;
+    mapped_file file;
+    size_type node_count;
+    size_type value_count;
+    const frozen_node * nodes;
+    const std::uint32_t * labels;
+    const size_type * children;
+    const letter_type * letters;
+    const size_type * value_nodes;
+    const mapped_type * values;
+};
+
+#endif //PREFIX_TREE_FROZEN_PREFIX_TREE_H
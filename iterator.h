@@ -10,6 +10,104 @@
 #include <iterator>
 #include "util/types.h"
 
+// Key of the entry an iterator points to. With keyed values it is read from the value holder,
+// with keyless values it is rebuilt in a buffer on the first call to key(), then kept up to date as the
+// iterator moves.
+template <typename Node, bool Keyless = Node::storage_type::keyless>
+class key_tracker
+{
+public:
+    typedef Node node_type;
+    typedef typename node_type::key_type key_type;
+    typedef typename node_type::charset_type charset_type;
+
+    explicit key_tracker(const charset_type * abc) noexcept
+    {
+    }
+
+    void reset(const node_type * node) noexcept
+    {
+    }
+
+    void descend(const node_type * child) noexcept
+    {
+    }
+
+    void ascend(const node_type * child) noexcept
+    {
+    }
+
+    const key_type & key(const node_type * node) const noexcept
+    {
+        return node->get_value()->first;
+    }
+};
+
+template <typename Node>
+class key_tracker<Node, true>
+{
+public:
+    typedef Node node_type;
+    typedef typename node_type::key_type key_type;
+    typedef typename node_type::charset_type charset_type;
+
+    explicit key_tracker(const charset_type * abc) noexcept
+    :abc(abc)
+    ,built(false)
+    {
+    }
+
+    // the key of node is only rebuilt from the root when asked for
+    void reset(const node_type * node) noexcept
+    {
+        built = false;
+    }
+
+    void descend(const node_type * child)
+    {
+        if(built)
+        {
+            buffer.push_back(abc->to_char_type(child->get_parent().second));
+            buffer.append(child->prefix_begin(), child->prefix_end());
+        }
+    }
+
+    void ascend(const node_type * child) noexcept
+    {
+        if(built)
+        {
+            buffer.resize(buffer.size() - std::distance(child->prefix_begin(), child->prefix_end()) - 1);
+        }
+    }
+
+    const key_type & key(const node_type * node) const
+    {
+        if(!built)
+        {
+            buffer.clear();
+            append_path(node);
+            built = true;
+        }
+        return buffer;
+    }
+
+private:
+    void append_path(const node_type * node) const
+    {
+        const auto & parent = node->get_parent();
+        if(parent.first)
+        {
+            append_path(parent.first);
+            buffer.push_back(abc->to_char_type(parent.second));
+        }
+        buffer.append(node->prefix_begin(), node->prefix_end());
+    }
+
+    const charset_type * abc;
+    mutable key_type buffer;
+    mutable bool built;
+};
+
 template <typename Node, class Const>
 class prefix_tree_iterator
 {
@@ -19,6 +117,10 @@ public:
     typedef prefix_tree_iterator<node_type, constness_type> type;
 
     typedef typename node_type::value_holder value_type;
+    typedef typename node_type::key_type key_type;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename node_type::storage_type storage_type;
+    typedef key_tracker<node_type> key_tracker_type;
 
     typedef prefix_tree_iterator<node_type, readwrite_type> readwrite_iterator_type;
     typedef typename std::conditional<std::is_same<constness_type, readonly_type>::value, readwrite_type, readonly_type>::type other_constness;
@@ -26,33 +128,40 @@ public:
     friend other_type;
 
     static constexpr bool constness = std::is_same<constness_type, readonly_type>::value;
+    static constexpr bool keyless = storage_type::keyless;
     typedef typename std::conditional<constness, const node_type *, node_type *>::type node_ptr;
     typedef typename std::conditional<constness, typename node_type::const_iterator, typename node_type::iterator>::type node_iterator;
     typedef typename std::conditional<constness, const value_type &, value_type &>::type reference;
     typedef typename std::conditional<constness, const value_type *, value_type *>::type pointer;
+    typedef typename std::conditional<constness, const typename node_type::value_type &, typename node_type::value_type &>::type mapped_reference;
 
-    static type make_begin(node_ptr node)
+    // keyless iterators need the charset to rebuild keys
+    static type make_begin(node_ptr node, const charset_type * abc = nullptr)
     {
-        return type(node, node ? node->get_parent().first : nullptr);
+        return type(node, node ? node->get_parent().first : nullptr, abc);
     }
 
-    static type make_end(node_ptr node)
+    static type make_end(node_ptr node, const charset_type * abc = nullptr)
     {
         node_ptr last = node ? node->get_parent().first : nullptr;
-        return type(last, last);
+        return type(last, last, abc);
     }
 
-    explicit prefix_tree_iterator(node_ptr node, node_ptr last) noexcept
+    explicit prefix_tree_iterator(node_ptr node, node_ptr last, const charset_type * abc = nullptr) noexcept(!keyless)
     :last(last)
+    ,tracker(abc)
     {
+        if(node != last)
+        {
+            tracker.reset(node);
+        }
         while(node != last && !node->get_value())
         {
             node_iterator it = node->begin();
-            node_iterator end = node->end();
-            for(; it != end && !*it; ++it);
-            if(it != end)
+            if(it != node->end())
             {
-                node = it->get();
+                node = *it;
+                tracker.descend(node);
             }
             else
             {
@@ -62,9 +171,19 @@ public:
         current = node;
     }
 
-    prefix_tree_iterator(readwrite_iterator_type && iterator) noexcept
+    template<class C, class = typename std::enable_if<constness && std::is_same<C, readwrite_type>::value>::type>
+    prefix_tree_iterator(const prefix_tree_iterator<node_type, C> & iterator)
+    :current(iterator.current)
+    ,last(iterator.last)
+    ,tracker(iterator.tracker)
+    {
+    }
+
+    template<class C, class = typename std::enable_if<constness && std::is_same<C, readwrite_type>::value>::type>
+    prefix_tree_iterator(prefix_tree_iterator<node_type, C> && iterator) noexcept
     :current(std::move(iterator.current))
     ,last(std::move(iterator.last))
+    ,tracker(std::move(iterator.tracker))
     {
     }
 
@@ -78,6 +197,16 @@ public:
         return current->get_value().get();
     }
 
+    const key_type & key() const
+    {
+        return tracker.key(current);
+    }
+
+    mapped_reference value() const
+    {
+        return storage_type::value(*current->get_value());
+    }
+
     bool operator ==(const type & right) const noexcept
     {
         return current == right.current;
@@ -88,35 +217,32 @@ public:
         return current != right.current;
     }
 
-    type & operator++() noexcept
+    type & operator++() noexcept(!keyless)
     {
         if(current != last)
         {
             pointer value = nullptr;
             node_iterator it = current->begin();
-
-            if(current->is_leaf())
-            {
-                it = current->end();
-            }
             do
             {
-                node_iterator end = current->end();
-                for(; it != end && !*it; ++it);
-                if(it != end)
+                if(it != current->end())
                 {
-                    current = it->get();
+                    current = *it;
+                    tracker.descend(current);
                     value = current->get_value().get();
                     it = current->begin();
                 }
                 else
                 {
                     const auto & parent = current->get_parent();
+                    if(parent.first)
+                    {
+                        tracker.ascend(current);
+                    }
                     current = parent.first;
                     if(current != last)
                     {
-                        it = current->begin();
-                        std::advance(it, parent.second + 1);
+                        it = current->lower_bound(parent.second + 1);
                     }
                 }
             }
@@ -137,7 +263,8 @@ public:
 
 private:
     node_ptr current;
-    node_ptr const last;
+    node_ptr last;
+    key_tracker_type tracker;
 };
 
 #endif //PREFIX_TREE_ITERATOR_H
@@ -0,0 +1,399 @@
+#ifndef PREFIX_TREE_LOUDS_PREFIX_TREE_H
+#define PREFIX_TREE_LOUDS_PREFIX_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util/bit_vector.h"
+#include "util/mismatch.h"
+
+template <typename Tree>
+class louds_prefix_tree_iterator
+{
+public:
+    typedef Tree tree_type;
+    typedef louds_prefix_tree_iterator<tree_type> type;
+    typedef typename tree_type::key_type key_type;
+    typedef typename tree_type::mapped_type mapped_type;
+    typedef typename tree_type::size_type size_type;
+
+    typedef std::forward_iterator_tag iterator_category;
+    typedef mapped_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const mapped_type * pointer;
+    typedef const mapped_type & reference;
+
+    static constexpr size_type npos = tree_type::npos;
+
+    // end iterator
+    explicit louds_prefix_tree_iterator(const tree_type * tree) noexcept
+    :tree(tree)
+    ,current(npos)
+    ,bound(npos)
+    {
+    }
+
+    // first entry of the sub tree of node, iteration stops when leaving it
+    louds_prefix_tree_iterator(const tree_type * tree, size_type node)
+    :tree(tree)
+    ,current(node)
+    ,bound(node)
+    {
+        tree->append_key(key_buffer, node);
+        if(!tree->has_value(current))
+        {
+            ++*this;
+        }
+    }
+
+    reference operator*() const noexcept
+    {
+        return tree->value_of(current);
+    }
+
+    pointer operator->() const noexcept
+    {
+        return &tree->value_of(current);
+    }
+
+    const key_type & key() const noexcept
+    {
+        return key_buffer;
+    }
+
+    reference value() const noexcept
+    {
+        return tree->value_of(current);
+    }
+
+    bool operator ==(const type & right) const noexcept
+    {
+        return current == right.current;
+    }
+
+    bool operator !=(const type & right) const noexcept
+    {
+        return current != right.current;
+    }
+
+    // next node with a value in DFS order, the key is updated as the walk goes down and up
+    type & operator++()
+    {
+        do
+        {
+            advance();
+        }
+        while(current != npos && !tree->has_value(current));
+        return *this;
+    }
+
+private:
+    void advance()
+    {
+        size_type child = tree->first_child(current);
+        if(child != npos)
+        {
+            current = child;
+            descend();
+            return;
+        }
+        while(current != bound)
+        {
+            ascend();
+            size_type sibling = tree->next_sibling(current);
+            if(sibling != npos)
+            {
+                current = sibling;
+                descend();
+                return;
+            }
+            current = tree->parent(current);
+        }
+        current = npos;
+    }
+
+    void descend()
+    {
+        key_buffer.push_back(tree->abc.to_char_type(tree->labels[current]));
+        std::pair<const typename tree_type::letter_type *, const typename tree_type::letter_type *> prefix = tree->prefix(current);
+        key_buffer.append(prefix.first, prefix.second);
+    }
+
+    void ascend()
+    {
+        std::pair<const typename tree_type::letter_type *, const typename tree_type::letter_type *> prefix = tree->prefix(current);
+        key_buffer.resize(key_buffer.size() - (prefix.second - prefix.first) - 1);
+    }
+
+    const tree_type * tree;
+    size_type current;
+    size_type bound;
+    key_type key_buffer;
+};
+
+// Read only succinct copy of a prefix tree, built by prefix_tree::succinct.
+// Topology in LOUDS: nodes are numbered in BFS order and node k writes one bit 1 per sub node then a 0,
+// after a leading 10 for the root. Sub nodes of k are consecutive numbers, so only the label of each node
+// is stored, as a charset index. Prefixes are concatenated in a tail array whose bit vector marks where
+// each non empty prefix starts. Values are kept in BFS order of their nodes.
+// About 1.5 bytes of structure per node with labels of one byte, plus the tail letters and 1 bit per letter.
+template<class K, class T, class Charset>
+class louds_prefix_tree
+{
+public:
+    typedef std::size_t size_type;
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef Charset charset_type;
+    typedef louds_prefix_tree<key_type, mapped_type, charset_type> type;
+    typedef mapped_type value_type;
+
+    typedef typename charset_type::letter_type letter_type;
+    typedef typename key_type::const_iterator key_const_iterator;
+    typedef typename std::conditional<(charset_type::size <= 256), std::uint8_t, std::uint32_t>::type label_type;
+
+    typedef louds_prefix_tree_iterator<type> const_iterator;
+    typedef const_iterator iterator;
+    friend const_iterator;
+
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    template<typename Node>
+    static type build(const Node * root, const charset_type & abc)
+    {
+        type result(abc);
+        result.louds.push_back(true);
+        result.louds.push_back(false);
+        result.labels.push_back(0);
+
+        std::deque<const Node *> queue(1, root);
+        while(!queue.empty())
+        {
+            const Node * n = queue.front();
+            queue.pop_front();
+            for(typename Node::const_iterator it = n->begin(), last = n->end(); it != last; ++it)
+            {
+                result.louds.push_back(true);
+                result.labels.push_back((label_type)it.index());
+                queue.push_back(*it);
+            }
+            result.louds.push_back(false);
+
+            result.values_present.push_back((bool)n->get_value());
+            if(n->get_value())
+            {
+                result.values.push_back(Node::storage_type::value(*n->get_value()));
+            }
+            result.prefixes_present.push_back(n->prefix_begin() != n->prefix_end());
+            bool first = true;
+            for(auto pi = n->prefix_begin(); pi != n->prefix_end(); ++pi)
+            {
+                result.tail.push_back(*pi);
+                result.tail_starts.push_back(first);
+                first = false;
+            }
+        }
+        result.louds.build_index();
+        result.values_present.build_index();
+        result.prefixes_present.build_index();
+        result.tail_starts.build_index();
+        result.labels.shrink_to_fit();
+        result.tail.shrink_to_fit();
+        result.values.shrink_to_fit();
+        return result;
+    }
+
+    const mapped_type & at(const key_type & key) const
+    {
+        size_type node = exact_node(key);
+        if(node == npos)
+        {
+            throw std::out_of_range("key not found");
+        }
+        return value_of(node);
+    }
+
+    const_iterator find(const key_type & key) const
+    {
+        size_type node = exact_node(key);
+        return node == npos ? end() : const_iterator(this, node);
+    }
+
+    size_type count(const key_type & key) const
+    {
+        return exact_node(key) == npos ? 0 : 1;
+    }
+
+    // entries whose key starts with prefix, the sub tree the prefix ends in
+    std::pair<const_iterator, const_iterator> equal_prefix_range(const key_type & prefix) const
+    {
+        key_const_iterator start = prefix.begin();
+        size_type node = locate(start, prefix.end()).first;
+        if(start != prefix.end())
+        {
+            return std::make_pair(end(), end());
+        }
+        return std::make_pair(const_iterator(this, node), end());
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator cbegin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(this);
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return const_iterator(this);
+    }
+
+    size_type size() const noexcept
+    {
+        return values.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return values.empty();
+    }
+
+    // bytes used by the topology, the labels and the node bit vectors
+    size_type structure_bytes() const noexcept
+    {
+        return louds.bytes() + labels.size() * sizeof(label_type) + values_present.bytes() + prefixes_present.bytes();
+    }
+
+    // bytes used by the prefix letters and their start marks, one bit per letter
+    size_type tail_bytes() const noexcept
+    {
+        return tail.size() * sizeof(letter_type) + tail_starts.bytes();
+    }
+
+    size_type node_count() const noexcept
+    {
+        return labels.size();
+    }
+
+private:
+    explicit louds_prefix_tree(const charset_type & abc)
+    :abc(abc)
+    {
+    }
+
+    // walk [start, last) from the root: last node reached and whether its prefix has been matched to its end
+    std::pair<size_type, bool> locate(key_const_iterator & start, key_const_iterator last) const
+    {
+        size_type node = 0;
+        while(true)
+        {
+            std::pair<const letter_type *, const letter_type *> p = prefix(node);
+            const letter_type * pi = p.first;
+            match_prefix(abc, pi, p.second, start, last);
+            if(pi != p.second || start == last)
+            {
+                return std::make_pair(node, pi == p.second);
+            }
+            size_type child = child_of(node, (size_type)abc.to_int_type(*start));
+            if(child == npos)
+            {
+                return std::make_pair(node, true);
+            }
+            ++start;
+            node = child;
+        }
+    }
+
+    size_type exact_node(const key_type & key) const
+    {
+        key_const_iterator start = key.begin();
+        std::pair<size_type, bool> p = locate(start, key.end());
+        return start == key.end() && p.second && has_value(p.first) ? p.first : npos;
+    }
+
+    size_type child_of(size_type node, size_type label) const noexcept
+    {
+        size_type first = louds.select0(node) + 1;
+        size_type last = louds.select0(node + 1);
+        const label_type * begin = labels.data() + first - node - 1;
+        const label_type * end = begin + (last - first);
+        const label_type * it = std::lower_bound(begin, end, (label_type)label);
+        return it != end && *it == label ? (size_type)(it - labels.data()) : npos;
+    }
+
+    size_type first_child(size_type node) const noexcept
+    {
+        size_type first = louds.select0(node) + 1;
+        return louds[first] ? first - node - 1 : npos;
+    }
+
+    size_type next_sibling(size_type node) const noexcept
+    {
+        size_type position = louds.select1(node);
+        return louds[position + 1] ? node + 1 : npos;
+    }
+
+    size_type parent(size_type node) const noexcept
+    {
+        return louds.select1(node) - node - 1;
+    }
+
+    std::pair<const letter_type *, const letter_type *> prefix(size_type node) const noexcept
+    {
+        if(!prefixes_present[node])
+        {
+            return std::make_pair(tail.data(), tail.data());
+        }
+        size_type j = prefixes_present.rank1(node);
+        size_type first = tail_starts.select1(j);
+        size_type last = j + 1 < tail_starts.count1() ? tail_starts.select1(j + 1) : tail.size();
+        return std::make_pair(tail.data() + first, tail.data() + last);
+    }
+
+    bool has_value(size_type node) const noexcept
+    {
+        return values_present[node];
+    }
+
+    const mapped_type & value_of(size_type node) const noexcept
+    {
+        return values[values_present.rank1(node)];
+    }
+
+    void append_key(key_type & key, size_type node) const
+    {
+        if(node)
+        {
+            append_key(key, parent(node));
+            key.push_back(abc.to_char_type(labels[node]));
+        }
+        std::pair<const letter_type *, const letter_type *> p = prefix(node);
+        key.append(p.first, p.second);
+    }
+
+    charset_type abc;
+    bit_vector louds;
+    std::vector<label_type> labels;         // label of each node in BFS order, 0 for the root
+    bit_vector values_present;
+    bit_vector prefixes_present;
+    std::vector<letter_type> tail;
+    bit_vector tail_starts;
+    std::vector<mapped_type> values;
+};
+
+#endif //PREFIX_TREE_LOUDS_PREFIX_TREE_H
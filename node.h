@@ -5,13 +5,23 @@
 #ifndef PREFIX_TREE_NODE_H
 #define PREFIX_TREE_NODE_H
 
+#include <algorithm>
 #include <utility>
+#include <stdexcept>
+#include <cstdint>
 #include <type_traits>
 #include <iterator>
 #include <memory>
+#include <vector>
 
 #include "util/types.h"
-#include "util/initialized_array.h"
+#include "util/memory.h"
+#include "util/mismatch.h"
+#include "util/prefetch.h"
+#include "node_container.h"
+#include "node_link.h"
+#include "value_storage.h"
+#include "value_score.h"
 #include "iterator.h"
 
 template<typename Node>
@@ -25,80 +35,230 @@ struct getter
     typedef typename node_type::key_const_iterator key_const_iterator;
     typedef typename node_type::size_type size_type;
 
+    template<typename KeyIterator>
     static std::pair<prefix_const_iterator, raw_node_type *> get_node
     (
     prefix_const_iterator pi,
     raw_node_type * node,
     const charset_type & abc,
-    key_const_iterator start,
-    key_const_iterator last
+    KeyIterator start,
+    KeyIterator last
     )
     {
-        bool matching;
         while(node && start != last)
         {
             prefix_const_iterator pend = node->prefix.end();
-            for(;pi != pend && start != last && (matching = *pi == abc.to_int_type(*start)); ++pi, ++start);
+            match_prefix(abc, pi, pend, start, last);
             if(pi == pend && start != last)
             {
-                if(node->next)
-                {
-                    size_type i = (size_type) abc.to_int_type(*start);
-                    node = node->next->operator[](i).get();
-                    if(node)
-                    {
-                        ++start;
-                        pi = node->prefix.begin();
-                    }
-                }
-                else
+                size_type i = (size_type) abc.to_int_type(*start);
+                node = node->get_next(i);
+                if(node)
                 {
-                    node = nullptr;
+                    ++start;
+                    pi = node->prefix.begin();
                 }
             }
-            else if(!matching)
+            else if(start != last) // mismatch inside the prefix
             {
                 node = nullptr;
             }
         }
         return std::make_pair(pi, node);
     }
+
+    // call f(node, length) for each node holding a value whose key is made of the first length letters
+    // of [start, last), from the shortest key to the longest
+    template<typename KeyIterator, typename F>
+    static void visit_prefixes(raw_node_type * node, const charset_type & abc, KeyIterator start, KeyIterator last, F f)
+    {
+        size_type length = 0;
+        while(true)
+        {
+            prefix_const_iterator pbegin = node->prefix.begin();
+            prefix_const_iterator pi = pbegin;
+            prefix_const_iterator pend = node->prefix.end();
+            match_prefix(abc, pi, pend, start, last);
+            if(pi != pend)
+            {
+                return;
+            }
+            length += (size_type)std::distance(pbegin, pend);
+            if(node->get_value())
+            {
+                f(node, length);
+            }
+            if(start == last)
+            {
+                return;
+            }
+            node = node->get_next((size_type)abc.to_int_type(*start));
+            if(!node)
+            {
+                return;
+            }
+            ++start;
+            ++length;
+        }
+    }
 };
 
-template<typename Node>
+template<typename Node, typename KeyIterator>
 inline std::pair<typename Node::prefix_const_iterator, const Node *> get_node
 (
 typename Node::prefix_const_iterator pi,
 const Node * node,
 const typename Node::charset_type & abc,
-typename Node::key_const_iterator start,
-typename Node::key_const_iterator last
+KeyIterator start,
+KeyIterator last
 )
 {
     return getter<const Node>::get_node(pi, node, abc, start, last);
 };
 
-template<typename Node>
+template<typename Node, typename KeyIterator>
 inline std::pair<typename Node::prefix_const_iterator, Node *> get_node
 (
 typename Node::prefix_const_iterator pi,
 Node * node,
 const typename Node::charset_type & abc,
-typename Node::key_const_iterator start,
-typename Node::key_const_iterator last
+KeyIterator start,
+KeyIterator last
 )
 {
     return getter<Node>::get_node(pi, node, abc, start, last);
 };
 
 
+// Walks many keys down the tree at once. Going down one level takes two steps for a lookup: entering
+// the node, which prefetches its prefix letters and the slot the key leads to, then matching the prefix
+// and reading the slot, which prefetches the sub node. The other lookups of the window run between the
+// two steps, so their cache misses overlap instead of following each other.
+template<typename Node>
+struct batch_getter
+{
+    typedef Node raw_node_type;
+    typedef typename std::remove_const<raw_node_type>::type node_type;
+    typedef batch_getter<raw_node_type> type;
+    typedef typename node_type::prefix_const_iterator prefix_const_iterator;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename charset_type::letter_type letter_type;
+    typedef typename node_type::size_type size_type;
+
+    // lookups in flight
+    static constexpr size_type window = 16;
+
+    // call done(i, p) for the i-th key of [first, last), in any order, p being what get_node returns for it.
+    // Keys are read as key_range, in place, so they must stay alive while the batch runs.
+    template<class KeyIterator, class Done>
+    static void get_nodes(raw_node_type * root, const charset_type & abc, KeyIterator first, KeyIterator last, Done done)
+    {
+        typedef key_range<letter_type, typename std::iterator_traits<KeyIterator>::value_type> range_type;
+        typedef lookup<typename range_type::iterator> lookup_type;
+        lookup_type lookups[window];
+        size_type active = 0;
+        size_type next_index = 0;
+        for(; active != window && first != last; ++first)
+        {
+            lookups[active++] = lookup_type(root, range_type::letters(*first), next_index++);
+        }
+        while(active)
+        {
+            for(size_type j = 0; j < active;)
+            {
+                lookup_type & l = lookups[j];
+                if(step(l, abc))
+                {
+                    ++j;
+                    continue;
+                }
+                done(l.index, std::make_pair(l.pi, l.node));
+                if(first != last)
+                {
+                    l = lookup_type(root, range_type::letters(*first), next_index++);
+                    ++first;
+                    ++j;
+                }
+                else
+                {
+                    l = lookups[--active];
+                }
+            }
+        }
+    }
+
+private:
+    template<typename KeyIterator>
+    struct lookup
+    {
+        lookup() noexcept = default;
+
+        lookup(raw_node_type * root, const std::pair<KeyIterator, KeyIterator> & letters, size_type index)
+        :node(root)
+        ,pi()
+        ,start(letters.first)
+        ,last(letters.second)
+        ,index(index)
+        ,entered(false)
+        {
+        }
+
+        raw_node_type * node;
+        prefix_const_iterator pi;
+        KeyIterator start;
+        KeyIterator last;
+        size_type index;
+        bool entered;
+    };
+
+    // one step of l, false once it is over
+    template<typename Lookup>
+    static bool step(Lookup & l, const charset_type & abc)
+    {
+        if(!l.entered)
+        {
+            l.pi = l.node->prefix.begin();
+            auto length = std::distance(l.pi, l.node->prefix.end());
+            l.node->prefetch_prefix();
+            if(length < std::distance(l.start, l.last))
+            {
+                l.node->prefetch_next((size_type)abc.to_int_type(*std::next(l.start, length)));
+            }
+            l.entered = true;
+            return true;
+        }
+        if(l.start == l.last)
+        {
+            return false;
+        }
+        prefix_const_iterator pend = l.node->prefix.end();
+        match_prefix(abc, l.pi, pend, l.start, l.last);
+        if(l.pi == pend && l.start != l.last)
+        {
+            raw_node_type * child = l.node->get_next((size_type)abc.to_int_type(*l.start));
+            l.node = child;
+            if(!child)
+            {
+                return false;
+            }
+            ++l.start;
+            prefetch_read(child);
+            l.entered = false;
+            return true;
+        }
+        if(l.start != l.last) // mismatch inside the prefix
+        {
+            l.node = nullptr;
+        }
+        return false;
+    }
+};
+
 template<typename Node>
 struct inserter
 {
     typedef Node node_type;
     typedef inserter<node_type> type;
-    typedef typename node_type::node_ptr node_ptr;
-    typedef typename node_type::node_deleter_type node_deleter_type;
     typedef typename node_type::size_type size_type;
     typedef typename node_type::prefix_type prefix_type;
     typedef typename node_type::prefixer_type prefixer_type;
@@ -122,39 +282,34 @@ struct inserter
     key_const_iterator last
     )
     {
-        node_ptr empty_pair(nullptr, node_deleter_type(node_allocator));
         while(start != last)
         {
             size_type i = (size_type)abc.to_int_type(*start);
-            node_ptr & p = root->get_next(i, empty_pair);
-            node_type * current = p.get();
+            node_type * current = root->get_next(i);
             ++start;
             if(current == nullptr)
             {
                 prefix_type remaining = prefixer_type::make_prefix(key, std::distance(key.cbegin(), start), std::distance(start, last));
                 start = last;
 
-                root->ensure_next(node_container_allocator, node_allocator);
-                root->allocate_node(node_allocator, i, std::move(remaining) );
-                current = root->next->operator[](i).get();
+                current = root->allocate_node(node_allocator, node_container_allocator, i, std::move(remaining));
             }
             else
             {
                 prefix_const_iterator pi = current->prefix.begin();
                 prefix_const_iterator pend = current->prefix.end();
-                for(; pi != pend && start != last && *pi == abc.to_int_type(*start); ++pi, ++start);
-                if(pi != pend)
+                match_prefix(abc, pi, pend, start, last);
+                if(pi != pend) // split current, the letter at pi becomes the index of its second half
                 {
-                    node_ptr jnode(p.release(), node_deleter_type(node_allocator));
                     auto length = std::distance(current->prefix.cbegin(), pi);
+                    size_type j = (size_type)abc.to_int_type(*pi);
                     prefix_type first_half = prefixer_type::make_prefix(current->prefix, 0, length);
-                    prefix_type second_half = prefixer_type::make_prefix(current->prefix, length, std::distance(pi, pend));
+                    prefix_type second_half = prefixer_type::make_prefix(current->prefix, length + 1, std::distance(pi, pend) - 1);
 
-                    node_ptr & new_p = root->allocate_node(node_allocator, i, std::move(first_half));
-
-                    new_p->ensure_next(node_container_allocator, node_allocator);
-                    new_p->set_node((size_type)*pi, std::move(second_half), std::move(jnode));
-                    current = new_p.get();
+                    node_type * new_node = root->make_node(node_allocator, i, std::move(first_half));
+                    node_type * jnode = root->exchange_node(i, new_node);
+                    new_node->set_node(node_container_allocator, j, std::move(second_half), jnode);
+                    current = new_node;
                 }
             }
             root = current;
@@ -179,15 +334,628 @@ typename Node::key_const_iterator last
     return inserter<Node>::insert_node(root, node_container_allocator, node_allocator, prefix_allocator, abc, key, start, last);
 };
 
+// Appends keys given in increasing order, keeping the path from the root to the last appended
+// key. Each key is compared once against that path, which gives the node it branches off.
+template<typename Node>
+class appender
+{
+public:
+    typedef Node node_type;
+    typedef appender<node_type> type;
+    typedef typename node_type::size_type size_type;
+    typedef typename node_type::prefix_type prefix_type;
+    typedef typename node_type::prefixer_type prefixer_type;
+    typedef typename node_type::key_const_iterator key_const_iterator;
+    typedef typename node_type::prefix_const_iterator prefix_const_iterator;
+    typedef typename node_type::node_container_allocator_type node_container_allocator_type;
+    typedef typename node_type::node_allocator_type node_allocator_type;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename node_type::key_type key_type;
+
+    appender
+    (
+    node_type * root,
+    node_container_allocator_type & node_container_allocator,
+    node_allocator_type & node_allocator,
+    const charset_type & abc
+    )
+    :node_container_allocator(node_container_allocator)
+    ,node_allocator(node_allocator)
+    ,abc(abc)
+    ,path(1, root)
+    {
+    }
+
+    // node of key, nullptr when key is less than the last appended key. The letters of key
+    // before start are the path to the first node given to the appender.
+    node_type * append(const key_type & key, key_const_iterator start)
+    {
+        key_const_iterator last = key.cend();
+        size_type depth = 0;
+        node_type * current = path.front();
+        while(true)
+        {
+            prefix_const_iterator pi = current->prefix.begin();
+            prefix_const_iterator pend = current->prefix.end();
+            match_prefix(abc, pi, pend, start, last);
+            if(pi != pend) // key branches off inside the prefix of current
+            {
+                if(start == last || abc.to_int_type(*start) < abc.to_int_type(*pi))
+                {
+                    return nullptr;
+                }
+                path.resize(depth);
+                current = split(current, pi);
+                path.push_back(current);
+                break;
+            }
+            if(start == last)
+            {
+                return depth + 1 == path.size() ? current : nullptr;
+            }
+            if(depth + 1 == path.size())
+            {
+                break;
+            }
+            node_type * child = path[depth + 1];
+            size_type i = (size_type)abc.to_int_type(*start);
+            size_type j = child->get_parent().second;
+            if(i < j)
+            {
+                return nullptr;
+            }
+            if(i > j)
+            {
+                path.resize(depth + 1);
+                break;
+            }
+            ++start;
+            ++depth;
+            current = child;
+        }
+        size_type i = (size_type)abc.to_int_type(*start);
+        ++start;
+        prefix_type remaining = prefixer_type::make_prefix(key, std::distance(key.cbegin(), start), std::distance(start, last));
+        current = current->allocate_node(node_allocator, node_container_allocator, i, std::move(remaining));
+        path.push_back(current);
+        return current;
+    }
+
+private:
+    // cut the prefix of current at pi, the returned node takes its place and holds the first half
+    node_type * split(node_type * current, prefix_const_iterator pi)
+    {
+        node_type * parent = current->get_parent().first;
+        size_type i = current->get_parent().second;
+        auto length = std::distance(current->prefix.cbegin(), pi);
+        size_type j = (size_type)abc.to_int_type(*pi);
+        prefix_type first_half = prefixer_type::make_prefix(current->prefix, 0, length);
+        prefix_type second_half = prefixer_type::make_prefix(current->prefix, length + 1, std::distance(pi, current->prefix.cend()) - 1);
+
+        node_type * new_node = parent->make_node(node_allocator, i, std::move(first_half));
+        parent->exchange_node(i, new_node);
+        new_node->set_node(node_container_allocator, j, std::move(second_half), current);
+        return new_node;
+    }
+
+    node_container_allocator_type & node_container_allocator;
+    node_allocator_type & node_allocator;
+    const charset_type & abc;
+    std::vector<node_type *> path;
+};
+
+// Order statistics from the number of values kept by each sub tree, entries are ordered as iterators visit them
+template<typename Node>
+struct ranker
+{
+    typedef Node raw_node_type;
+    typedef typename std::remove_const<raw_node_type>::type node_type;
+    typedef ranker<raw_node_type> type;
+    typedef typename node_type::prefix_const_iterator prefix_const_iterator;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename node_type::key_const_iterator key_const_iterator;
+    typedef typename node_type::size_type size_type;
+
+    // number of entries whose key is less than [start, last)
+    template<typename KeyIterator>
+    static size_type rank(raw_node_type * node, const charset_type & abc, KeyIterator start, KeyIterator last)
+    {
+        size_type result = 0;
+        while(node)
+        {
+            prefix_const_iterator pi = node->prefix_begin();
+            prefix_const_iterator pend = node->prefix_end();
+            match_prefix(abc, pi, pend, start, last);
+            if(pi != pend) // the whole sub tree is either less or greater than the key
+            {
+                if(start != last && abc.to_int_type(*pi) < abc.to_int_type(*start))
+                {
+                    result += node->subtree_size();
+                }
+                break;
+            }
+            if(start == last)
+            {
+                break;
+            }
+            if(node->get_value())
+            {
+                ++result;
+            }
+            size_type i = (size_type) abc.to_int_type(*start);
+            for(auto it = node->begin(), end = node->lower_bound(i); it != end; ++it)
+            {
+                result += (*it)->subtree_size();
+            }
+            node = node->get_next(i);
+            ++start;
+        }
+        return result;
+    }
+
+    // node holding the entry of rank i, nullptr when there are not more than i entries
+    static raw_node_type * select(raw_node_type * node, size_type i)
+    {
+        if(i >= node->subtree_size())
+        {
+            return nullptr;
+        }
+        while(true)
+        {
+            if(node->get_value())
+            {
+                if(i == 0)
+                {
+                    return node;
+                }
+                --i;
+            }
+            for(auto it = node->begin(), end = node->end(); it != end; ++it)
+            {
+                if(i < (*it)->subtree_size())
+                {
+                    node = *it;
+                    break;
+                }
+                i -= (*it)->subtree_size();
+            }
+        }
+    }
+};
+
+// Keys within a Levenshtein distance of a query. The walk goes down the tree in key order and carries one row
+// of the edit distance matrix per letter of the path, each row giving the distances between the path and the
+// prefixes of the query. A sub tree is left out as soon as every entry of the last row exceeds the distance,
+// since a longer key cannot come closer.
+template<typename Node>
+class fuzzy_finder
+{
+public:
+    typedef Node raw_node_type;
+    typedef typename std::remove_const<raw_node_type>::type node_type;
+    typedef fuzzy_finder<raw_node_type> type;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename node_type::key_type key_type;
+    typedef typename node_type::size_type size_type;
+    typedef typename charset_type::letter_type letter_type;
+
+    template<typename QueryIterator>
+    fuzzy_finder(const charset_type & abc, QueryIterator first, QueryIterator last, size_type distance, size_type limit)
+    :abc(abc)
+    ,query(first, last)
+    ,distance(distance)
+    ,limit(limit)
+    ,found(0)
+    {
+        for(size_type j = 0; j <= query.size(); ++j)
+        {
+            rows.push_back(j);
+        }
+    }
+
+    // call f(key, node, d) for each node holding a value whose key is at distance d <= distance of the
+    // query, in key order, until limit nodes are found. Returns the number of nodes found.
+    template<typename F>
+    size_type find(raw_node_type * root, F f)
+    {
+        if(limit)
+        {
+            visit(root, f);
+        }
+        return found;
+    }
+
+private:
+    // false when the walk is over
+    template<typename F>
+    bool visit(raw_node_type * node, F & f)
+    {
+        size_type pushed = 0;
+        bool result = true;
+        for(auto pi = node->prefix_begin(), pend = node->prefix_end(); pi != pend; ++pi)
+        {
+            ++pushed;
+            if(push(*pi) > distance)
+            {
+                pop(pushed);
+                return true;
+            }
+        }
+        size_type d = rows.back();
+        if(node->get_value() && d <= distance)
+        {
+            f(const_cast<const key_type &>(key), node, d);
+            result = ++found != limit;
+        }
+        for(auto it = node->begin(), last = node->end(); result && it != last; ++it)
+        {
+            if(push(abc.to_char_type(it.index())) <= distance)
+            {
+                result = visit(*it, f);
+            }
+            pop(1);
+        }
+        pop(pushed);
+        return result;
+    }
+
+    // append letter to the path, returns the least distance of the new row
+    size_type push(letter_type letter)
+    {
+        size_type width = query.size() + 1;
+        size_type previous = rows.size() - width;
+        rows.resize(rows.size() + width);
+        size_type * row = rows.data() + previous + width;
+        const size_type * above = rows.data() + previous;
+        row[0] = above[0] + 1;
+        size_type least = row[0];
+        for(size_type j = 1; j != width; ++j)
+        {
+            row[j] = std::min(std::min(above[j], row[j - 1]) + 1, above[j - 1] + (query[j - 1] == letter ? 0 : 1));
+            least = std::min(least, row[j]);
+        }
+        key.push_back(letter);
+        return least;
+    }
+
+    void pop(size_type letters)
+    {
+        rows.resize(rows.size() - letters * (query.size() + 1));
+        key.resize(key.size() - letters);
+    }
+
+    const charset_type & abc;
+    std::vector<letter_type> query;
+    size_type distance;
+    size_type limit;
+    size_type found;
+    std::vector<size_type> rows;    // one row per letter of the path after the row of the empty path
+    key_type key;
+};
+
+// Keys matching a glob pattern: * matches any letters, ? one letter, [abc], [a-z] one letter of a class,
+// [!abc] or [^abc] one letter out of it, a backslash makes the next letter literal. The pattern is
+// compiled to a small NFA whose states are the positions in the pattern, the walk carries the set of live
+// states down the tree and leaves out a sub tree once no state survives. When every live state expects a
+// literal, the sub nodes of these letters are reached through the child index instead of visiting them all.
+template<typename Node>
+class glob_matcher
+{
+public:
+    typedef Node raw_node_type;
+    typedef typename std::remove_const<raw_node_type>::type node_type;
+    typedef glob_matcher<raw_node_type> type;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename node_type::key_type key_type;
+    typedef typename node_type::size_type size_type;
+    typedef typename charset_type::letter_type letter_type;
+    typedef std::uint64_t word_type;
+
+    template<typename PatternIterator>
+    glob_matcher(const charset_type & abc, PatternIterator first, PatternIterator last)
+    :abc(abc)
+    ,found(0)
+    {
+        compile(first, last);
+        width = (steps.size() + 1 + 63) / 64;
+        states.assign(width, 0);
+        add(states.data(), 0);
+    }
+
+    // call f(key, node) for each node holding a value whose key matches, in key order. Returns the number of nodes found.
+    template<typename F>
+    size_type match(raw_node_type * root, F f)
+    {
+        visit(root, f);
+        return found;
+    }
+
+private:
+    enum kind_type { literal, any, letter_class, star };
+
+    struct step
+    {
+        kind_type kind;
+        size_type index;    // charset index of a literal, class of a letter_class
+    };
+
+    template<typename PatternIterator>
+    void compile(PatternIterator first, PatternIterator last)
+    {
+        while(first != last)
+        {
+            letter_type c = *first++;
+            if(c == letter_type('*'))
+            {
+                if(steps.empty() || steps.back().kind != star)
+                {
+                    steps.push_back(step{star, 0});
+                }
+            }
+            else if(c == letter_type('?'))
+            {
+                steps.push_back(step{any, 0});
+            }
+            else if(c == letter_type('['))
+            {
+                steps.push_back(step{letter_class, classes.size()});
+                classes.emplace_back(charset_type::size, false);
+                std::vector<bool> & members = classes.back();
+                bool negated = first != last && (*first == letter_type('!') || *first == letter_type('^'));
+                if(negated)
+                {
+                    ++first;
+                }
+                bool closed = false;
+                for(bool leading = true; first != last; leading = false)
+                {
+                    letter_type from = *first++;
+                    if(from == letter_type(']') && !leading)
+                    {
+                        closed = true;
+                        break;
+                    }
+                    letter_type to = from;
+                    PatternIterator dash = first;
+                    if(dash != last && *dash == letter_type('-') && ++dash != last && *dash != letter_type(']'))
+                    {
+                        to = *dash;
+                        first = ++dash;
+                    }
+                    for(size_type i = index(from), end = index(to); i <= end && i < charset_type::size; ++i)
+                    {
+                        members[i] = true;
+                    }
+                }
+                if(!closed)
+                {
+                    throw std::invalid_argument("unterminated letter class in pattern");
+                }
+                if(negated)
+                {
+                    members.flip();
+                }
+            }
+            else
+            {
+                if(c == letter_type('\\') && first != last)
+                {
+                    c = *first++;
+                }
+                steps.push_back(step{literal, index(c)});
+            }
+        }
+    }
+
+    size_type index(letter_type c) const
+    {
+        return (size_type)abc.to_int_type(c);
+    }
+
+    // add state j and the states reached from it without reading a letter
+    void add(word_type * set, size_type j) const noexcept
+    {
+        while(true)
+        {
+            set[j / 64] |= word_type(1) << (j % 64);
+            if(j == steps.size() || steps[j].kind != star)
+            {
+                return;
+            }
+            ++j;
+        }
+    }
+
+    static bool has(const word_type * set, size_type j) noexcept
+    {
+        return (set[j / 64] >> (j % 64)) & 1;
+    }
+
+    // push the states live after reading the letter of index i, false when there are none
+    bool push(size_type i)
+    {
+        size_type previous = states.size() - width;
+        states.resize(states.size() + width, 0);
+        const word_type * from = states.data() + previous;
+        word_type * to = states.data() + previous + width;
+        bool live = false;
+        for(size_type j = 0; j != steps.size(); ++j)
+        {
+            if(!has(from, j))
+            {
+                continue;
+            }
+            const step & s = steps[j];
+            bool accepted = s.kind == any || s.kind == star || (s.kind == literal && s.index == i) || (s.kind == letter_class && i < charset_type::size && classes[s.index][i]);
+            if(accepted)
+            {
+                add(to, s.kind == star ? j : j + 1);
+                live = true;
+            }
+        }
+        key.push_back(abc.to_char_type(i));
+        return live;
+    }
+
+    void pop(size_type letters)
+    {
+        states.resize(states.size() - letters * width);
+        key.resize(key.size() - letters);
+    }
+
+    template<typename F>
+    void visit(raw_node_type * node, F & f)
+    {
+        size_type pushed = 0;
+        for(auto pi = node->prefix_begin(), pend = node->prefix_end(); pi != pend; ++pi)
+        {
+            ++pushed;
+            if(!push(index(*pi)))
+            {
+                pop(pushed);
+                return;
+            }
+        }
+        const word_type * live = states.data() + states.size() - width;
+        if(node->get_value() && has(live, steps.size()))
+        {
+            f(const_cast<const key_type &>(key), node);
+            ++found;
+        }
+
+        size_type first = literals.size();
+        bool direct = true;
+        for(size_type j = 0; direct && j != steps.size(); ++j)
+        {
+            if(has(live, j))
+            {
+                direct = steps[j].kind == literal;
+                literals.push_back(steps[j].index);
+            }
+        }
+        if(direct)
+        {
+            std::sort(literals.begin() + first, literals.end());
+            literals.erase(std::unique(literals.begin() + first, literals.end()), literals.end());
+            for(size_type l = first; l != literals.size(); ++l)
+            {
+                size_type i = literals[l];
+                raw_node_type * child = i < charset_type::size ? node->get_next(i) : nullptr;
+                if(child)
+                {
+                    if(push(i))
+                    {
+                        visit(child, f);
+                    }
+                    pop(1);
+                }
+            }
+        }
+        else
+        {
+            for(auto it = node->begin(), last = node->end(); it != last; ++it)
+            {
+                if(push(it.index()))
+                {
+                    visit(*it, f);
+                }
+                pop(1);
+            }
+        }
+        literals.resize(first);
+        pop(pushed);
+    }
+
+    const charset_type & abc;
+    std::vector<step> steps;
+    std::vector<std::vector<bool> > classes;
+    size_type width;                // words of a set of states
+    std::vector<word_type> states;  // one set of live states per letter of the path after the set of the empty path
+    std::vector<size_type> literals;   // letters expected by the nodes of the path, when they are all literals
+    size_type found;
+    key_type key;
+};
+
+// Entries of a sub tree by decreasing score, from the best score cached by each node for its sub tree.
+// Candidates are sub trees and entries in a heap ordered by score: a sub tree is only opened when its
+// best score comes first, so k entries open about k * depth nodes.
+template<typename Node>
+struct top_scorer
+{
+    typedef Node raw_node_type;
+    typedef typename std::remove_const<raw_node_type>::type node_type;
+    typedef top_scorer<raw_node_type> type;
+    typedef typename node_type::size_type size_type;
+    typedef typename node_type::storage_type storage_type;
+    typedef typename node_type::score_cache_type score_cache_type;
+    typedef typename score_cache_type::score_type score_type;
+
+    // call f(n) for the k nodes of the sub tree of node holding the best values, by decreasing score
+    template<typename F>
+    static void top(raw_node_type * node, size_type k, F f)
+    {
+        if(!node || !node->subtree_size())
+        {
+            return;
+        }
+        std::vector<candidate> heap(1, candidate{node->subtree_score(), node, false});
+        while(k && !heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end());
+            candidate c = heap.back();
+            heap.pop_back();
+            if(c.entry)
+            {
+                f(c.node);
+                --k;
+                continue;
+            }
+            if(c.node->get_value())
+            {
+                heap.push_back(candidate{score_cache_type::score(storage_type::value(*c.node->get_value())), c.node, true});
+                std::push_heap(heap.begin(), heap.end());
+            }
+            for(auto it = c.node->begin(), last = c.node->end(); it != last; ++it)
+            {
+                heap.push_back(candidate{(*it)->subtree_score(), *it, false});
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+    }
+
+private:
+    struct candidate
+    {
+        score_type score;
+        raw_node_type * node;
+        bool entry;     // the value of node rather than its sub tree, first among equal scores
+
+        bool operator<(const candidate & right) const noexcept
+        {
+            return score < right.score || (score == right.score && entry < right.entry);
+        }
+    };
+};
+
 template<typename Node, typename Memory>
 struct remover
 {
     typedef Node node_type;
     typedef Memory memory_management_type;
     typedef remover<node_type, memory_management_type> type;
+    typedef typename node_type::node_container_allocator_type node_container_allocator_type;
+    typedef typename node_type::node_allocator_type node_allocator_type;
     typedef typename node_type::prefix_allocator_type prefix_allocator_type;
+    typedef typename node_type::charset_type charset_type;
 
-    static void remove_node(node_type * current, prefix_allocator_type & prefix_allocator);
+    static void remove_node
+    (
+    node_type * current,
+    node_container_allocator_type & node_container_allocator,
+    node_allocator_type & node_allocator,
+    prefix_allocator_type & prefix_allocator,
+    const charset_type & abc
+    );
 };
 
 template<typename Node>
@@ -198,47 +966,44 @@ struct remover<Node, own_memory>
     typedef typename node_type::prefixer_type prefixer_type;
     typedef typename node_type::value_holder_ptr value_holder_ptr;
     typedef typename node_type::size_type size_type;
-    typedef typename node_type::node_ptr node_ptr;
-    typedef typename node_type::content_const_iterator content_const_iterator;
     typedef typename node_type::iterator iterator;
     typedef typename node_type::prefix_type prefix_type;
+    typedef typename node_type::charset_type charset_type;
+    typedef typename node_type::node_container_allocator_type node_container_allocator_type;
+    typedef typename node_type::node_allocator_type node_allocator_type;
     typedef typename node_type::prefix_allocator_type prefix_allocator_type;
 
-    static void remove_node(node_type * current, prefix_allocator_type & prefix_allocator)
+    static void remove_node
+    (
+    node_type * current,
+    node_container_allocator_type & node_container_allocator,
+    node_allocator_type & node_allocator,
+    prefix_allocator_type & prefix_allocator,
+    const charset_type & abc
+    )
     {
-        auto size = prefixer_type::length(current->prefix);
-
-        value_holder_ptr toDelete(std::move(current->value));
-        if(current->parent_link.first && current->empty())
+        value_holder_ptr toDelete(current->take_value());
+        if(current->get_parent().first && current->empty())
         {
-            size_type i = current->parent_link.second;
-            current = current->parent_link.first;
-            size += prefixer_type::length(current->prefix) + 1;
-            node_ptr & p = current->next->operator[](i);
-            p.reset();
-            --current->nb_sub_node;
-            if(!current->nb_sub_node)
-            {
-                current->next.reset();
-            }
+            size_type i = current->get_parent().second;
+            current = current->get_parent().first;
+            node_type::destroy_node(current->release_node(node_container_allocator, i), node_container_allocator, node_allocator);
         }
-        if(toDelete && current->parent_link.first)
+        if(toDelete && current->get_parent().first)
         {
-            auto prefix_start = prefixer_type::length(toDelete->first) - size;
-            if(!current->value && current->nb_sub_node == 1) // if current only have one sub node -> current is not required anymore
+            if(!current->value && current->next.size() == 1) // if current only have one sub node -> current is not required anymore
             {
                 iterator it = current->begin();
-                for(iterator end = current->end(); it != end && !*it; ++it);
+                node_type * child = *it;
 
-                node_type * parent = current->parent_link.first;
-                size_type i = current->parent_link.second;
-                auto concatenated_size = prefixer_type::length(current->prefix) + prefixer_type::length((*it)->prefix) + 1;
+                node_type * parent = current->get_parent().first;
+                size_type i = current->get_parent().second;
 
-                content_const_iterator content = content_const_iterator::make_begin(current);
-                const auto & replacement_key = content->first;
-                prefix_type concatenated = prefixer_type::make_prefix(replacement_key, prefix_start, concatenated_size);
-                parent->set_node(i, std::move(concatenated), std::move(*it));
-                current = parent;
+                prefix_type concatenated = prefixer_type::concat(current->prefix, abc.to_char_type(it.index()), child->prefix);
+                current->release_node(node_container_allocator, it.index());
+                parent->exchange_node(i, child);
+                child->prefix = std::move(concatenated);
+                node_type::destroy_node(current, node_container_allocator, node_allocator);
             }
         }
     }
@@ -249,61 +1014,69 @@ struct remover<Node, shared_memory>
 {
     typedef Node node_type;
     typedef remover<node_type, shared_memory> type;
+    typedef typename node_type::charset_type charset_type;
     typedef typename node_type::prefixer_type prefixer_type;
     typedef typename node_type::value_holder_ptr value_holder_ptr;
     typedef typename node_type::size_type size_type;
-    typedef typename node_type::node_ptr node_ptr;
     typedef typename node_type::content_const_iterator content_const_iterator;
     typedef typename node_type::iterator iterator;
     typedef typename node_type::prefix_type prefix_type;
+    typedef typename node_type::node_container_allocator_type node_container_allocator_type;
+    typedef typename node_type::node_allocator_type node_allocator_type;
     typedef typename node_type::prefix_allocator_type prefix_allocator_type;
 
-    static void remove_node(node_type * current, prefix_allocator_type & prefix_allocator)
+    static void remove_node
+    (
+    node_type * current,
+    node_container_allocator_type & node_container_allocator,
+    node_allocator_type & node_allocator,
+    prefix_allocator_type & prefix_allocator,
+    const charset_type & abc
+    )
     {
+        static_assert(!node_type::storage_type::keyless, "prefixes sharing memory point into the stored keys");
         auto size = prefixer_type::length(current->prefix);
 
-        value_holder_ptr toDelete(std::move(current->value)); // remove value hold by node
-        if(current->parent_link.first && current->empty()) // if current is empty remove it
+        value_holder_ptr toDelete(current->take_value()); // remove value hold by node
+        if(current->get_parent().first && current->empty()) // if current is empty remove it
         {
-            size_type i = current->parent_link.second;
-            current = current->parent_link.first;
+            size_type i = current->get_parent().second;
+            current = current->get_parent().first;
             size += prefixer_type::length(current->prefix) + 1;
-            node_ptr & p = current->next->operator[](i);
-            p.reset();
-            --current->nb_sub_node;
-            if(!current->nb_sub_node)
-            {
-                current->next.reset();
-            }
+            node_type::destroy_node(current->release_node(node_container_allocator, i), node_container_allocator, node_allocator);
         }
-        if(toDelete && current->parent_link.first)
+        if(toDelete && current->get_parent().first)
         {
             auto prefix_start = prefixer_type::length(toDelete->first) - size;
-            if(!current->value && current->nb_sub_node == 1)
+            if(!current->value && current->next.size() == 1)
             {
                 iterator it = current->begin();
-                for(iterator end = current->end(); it != end && !*it; ++it);
+                node_type * child = *it;
 
-                node_type * parent = current->parent_link.first;
-                size_type i = current->parent_link.second;
-                auto concatenated_size = prefixer_type::length(current->prefix) + prefixer_type::length((*it)->prefix) + 1;
+                node_type * parent = current->get_parent().first;
+                size_type i = current->get_parent().second;
+                auto concatenated_size = prefixer_type::length(current->prefix) + prefixer_type::length(child->prefix) + 1;
 
                 content_const_iterator content = content_const_iterator::make_begin(current);
                 const auto & replacement_key = content->first;
                 prefix_type concatenated = prefixer_type::make_prefix(replacement_key, prefix_start, concatenated_size);
-                parent->set_node(i, std::move(concatenated), std::move(*it));
+                current->release_node(node_container_allocator, it.index());
+                parent->exchange_node(i, child);
+                child->prefix = std::move(concatenated);
+                node_type::destroy_node(current, node_container_allocator, node_allocator);
                 current = parent;
                 size = prefixer_type::length(current->prefix);
                 prefix_start -= (size+1);
             }
+            size = prefixer_type::length(current->prefix);
             content_const_iterator content = content_const_iterator::make_begin(current);
-            while(current->parent_link.first)
+            while(current->get_parent().first)
             {
                 if(prefixer_type::share_memory(current->prefix, prefixer_type::make_prefix(toDelete->first, prefix_start, size)))
                 {
                     current->prefix = prefixer_type::make_prefix(content->first, prefix_start, size);
                 }
-                current = current->parent_link.first;
+                current = current->get_parent().first;
                 size = prefixer_type::length(current->prefix);
                 prefix_start -= (size+1);
             }
@@ -312,13 +1085,20 @@ struct remover<Node, shared_memory>
 };
 
 template<typename Node>
-inline static void remove_node(Node * current, typename Node::prefix_allocator_type & prefix_allocator)
+inline static void remove_node
+(
+Node * current,
+typename Node::node_container_allocator_type & node_container_allocator,
+typename Node::node_allocator_type & node_allocator,
+typename Node::prefix_allocator_type & prefix_allocator,
+const typename Node::charset_type & abc
+)
 {
-    return remover<Node, typename Node::prefixer_type::prefix_life_cycle_traits>::remove_node(current, prefix_allocator);
+    return remover<Node, typename Node::prefixer_type::prefix_life_cycle_traits>::remove_node(current, node_container_allocator, node_allocator, prefix_allocator, abc);
 }
 
-template<typename K, typename V, class Charset, class Prefixer, class Allocator>
-class node
+template<typename K, typename V, class Charset, class Prefixer, class Allocator, class Link = pointer_link, class Storage = keyed_value, class Score = no_score>
+class node : public score_cache<Score, V>
 {
 public:
     typedef std::size_t size_type;
@@ -327,15 +1107,19 @@ public:
     typedef Charset charset_type;
     typedef Prefixer prefixer_type;
     typedef Allocator allocator_type;
+    typedef Link link_type;
+    typedef value_storage<key_type, value_type, Storage> storage_type;
 
-    typedef node<key_type, value_type, charset_type, prefixer_type, allocator_type> type;
-    typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<type> node_allocator_type;
-    typedef allocator_deleter<node_allocator_type> node_deleter_type;
-    typedef std::unique_ptr<type, node_deleter_type> node_ptr;
-    typedef std::pair<type *, size_type> parent_link_type;
+    typedef node<key_type, value_type, charset_type, prefixer_type, allocator_type, link_type, Storage, Score> type;
+    typedef score_cache<Score, value_type> score_cache_type;
+    typedef linker<type, link_type> linker_type;
+    typedef typename linker_type::template node_allocator_type<allocator_type> node_allocator_type;
+    typedef decltype(linker_type::root_allocator(std::declval<node_allocator_type &>())) root_allocator_type;
+    typedef typename linker_type::parent_link_type parent_link_type;
+    typedef typename linker_type::slot_type slot_type;
 
     typedef value_type * value_ptr;
-    typedef std::pair<key_type, value_type> value_holder;
+    typedef typename storage_type::value_holder value_holder;
     typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<value_holder> value_holder_allocator_type;
     typedef allocator_deleter<value_holder_allocator_type> value_holder_deleter_type;
     typedef std::unique_ptr<value_holder, value_holder_deleter_type> value_holder_ptr;
@@ -344,12 +1128,58 @@ public:
     typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<index_type> prefix_allocator_type;
     typedef typename prefixer_type::prefix_type prefix_type;
     typedef typename prefix_type::const_iterator prefix_const_iterator;
-    typedef std::array<node_ptr, charset_type::size> node_container;
+    typedef adaptive_node_container<slot_type, charset_type::size> node_container;
     typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<node_container> node_container_allocator_type;
-    typedef std::unique_ptr<node_container> node_container_ptr;
 
-    typedef typename node_container::iterator iterator;
-    typedef typename node_container::const_iterator const_iterator;
+    // iterate over the sub nodes, in index order
+    class child_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef type * value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef type * const * pointer;
+        typedef type * reference;
+
+        child_iterator(const type * owner, typename node_container::const_iterator it) noexcept
+        :owner(owner)
+        ,it(it)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return linker_type::resolve(owner, *it);
+        }
+
+        child_iterator & operator++() noexcept
+        {
+            ++it;
+            return *this;
+        }
+
+        bool operator==(const child_iterator & right) const noexcept
+        {
+            return it == right.it;
+        }
+
+        bool operator!=(const child_iterator & right) const noexcept
+        {
+            return it != right.it;
+        }
+
+        size_type index() const noexcept
+        {
+            return it.index();
+        }
+
+    private:
+        const type * owner;
+        typename node_container::const_iterator it;
+    };
+
+    typedef child_iterator iterator;
+    typedef child_iterator const_iterator;
 
     typedef typename key_type::iterator key_iterator;
     typedef typename key_type::const_iterator key_const_iterator;
@@ -359,70 +1189,141 @@ public:
 
     friend getter<const type>;
     friend getter<type>;
+    friend batch_getter<const type>;
+    friend batch_getter<type>;
     friend inserter<type>;
+    friend appender<type>;
     friend remover<type, typename prefixer_type::prefix_life_cycle_traits>;
 
     explicit node(parent_link_type && link, value_holder_ptr && value, node_allocator_type & node_allocator)
-    :parent_link(std::move(link))
-    ,nb_sub_node(0)
+    :entries(value ? 1 : 0)
     ,value(std::move(value))
     {
+        linker_type::set_parent(parent_link, std::move(link));
     }
 
-    ~node() noexcept
+    node(const node &) = delete;
+    node & operator=(const node &) = delete;
+
+    // sub nodes are released by clear, the node does not keep the allocators required to do it
+    ~node() noexcept = default;
+
+    void set_parent(parent_link_type && link)
     {
-        clear();
+        linker_type::set_parent(parent_link, std::move(link));
     }
 
-    void set_parent(parent_link_type && link)
+    typename linker_type::parent_reference get_parent() const noexcept
     {
-        parent_link = std::move(link);
+        return linker_type::parent(parent_link, this);
+    }
+
+    // allocate a detached node which will be linked as the sub node i of this node
+    type * make_node(node_allocator_type & node_allocator, size_type i, prefix_type && prefix)
+    {
+        unique_allocation<node_allocator_type> a(node_allocator, 1);
+        new((void *)a.get()) type(parent_link_type(this, i), value_holder_ptr(nullptr, value.get_deleter()), node_allocator);
+
+        type * new_node = a.release();
+        new_node->prefix = std::move(prefix);
+        return new_node;
     }
 
-    const parent_link_type & get_parent() const noexcept
+    // allocate a node without parent, from the root allocator of the link policy
+    static type * make_root(node_allocator_type & node_allocator, value_holder_ptr && value)
     {
-        return parent_link;
+        root_allocator_type root_allocator = linker_type::root_allocator(node_allocator);
+        unique_allocation<root_allocator_type> a(root_allocator, 1);
+        new((void *)a.get()) type(parent_link_type(nullptr, 0), std::move(value), node_allocator);
+        return a.release();
     }
 
-    void ensure_next(node_container_allocator_type & node_container_allocator, node_allocator_type & node_allocator)
+    type * allocate_node(node_allocator_type & node_allocator, node_container_allocator_type & node_container_allocator, size_type i, prefix_type && prefix)
     {
-        if(!next)
+        type * new_node = make_node(node_allocator, i, std::move(prefix));
+        try
+        {
+            next.insert(i, linker_type::slot(new_node), node_container_allocator);
+        }
+        catch(...)
         {
-            node_container * new_next = node_container_allocator.allocate(1);
-            new((void *)new_next) node_container(make_initialized_array<node_ptr, charset_type::size>(node_ptr(nullptr, node_deleter_type(node_allocator))));
-            next.reset(new_next);
+            destroy_node(new_node, node_container_allocator, node_allocator);
+            throw;
         }
+        return new_node;
     }
 
-    node_ptr & allocate_node(node_allocator_type & node_allocator, size_type i, prefix_type && prefix)
+    // link n as the sub node i, i must be free. Its entries are counted by this node only, as when
+    // n is split from the node this one replaces.
+    void set_node(node_container_allocator_type & node_container_allocator, size_type i, prefix_type && prefix, type * n)
     {
-        node_ptr & p = next->operator[](i);
+        next.insert(i, linker_type::slot(n), node_container_allocator);
+        n->prefix = std::move(prefix);
+        n->set_parent(parent_link_type(this, i));
+        entries += n->entries;
+        if constexpr(score_cache_type::scored)
+        {
+            this->best = std::max(this->best, n->best);
+        }
+    }
 
-        type * new_node = node_allocator.allocate(1);
-        new((void *)new_node) type(parent_link_type(this, i), value_holder_ptr(nullptr, value.get_deleter()), node_allocator);
+    // link n, detached from its previous parent with its prefix kept, as the sub node i, i must be free.
+    // Its entries are counted by every ancestor.
+    void attach_node(node_container_allocator_type & node_container_allocator, size_type i, type * n)
+    {
+        next.insert(i, linker_type::slot(n), node_container_allocator);
+        n->set_parent(parent_link_type(this, i));
+        for(type * ancestor = this; ancestor; ancestor = ancestor->get_parent().first)
+        {
+            ancestor->entries += n->entries;
+            if constexpr(score_cache_type::scored)
+            {
+                ancestor->best = std::max(ancestor->best, n->best);
+            }
+        }
+    }
 
-        new_node->prefix = std::move(prefix);
-        p.reset(new_node);
-        ++nb_sub_node;
-        return p;
+    // link n in place of the sub node i and return the previous one, which is not released
+    type * exchange_node(size_type i, type * n) noexcept
+    {
+        n->set_parent(parent_link_type(this, i));
+        return linker_type::resolve(this, next.replace(i, linker_type::slot(n)));
     }
 
-    void set_node(size_type i, prefix_type && prefix, node_ptr && n)
+    // unlink the sub node i and return it, its ownership goes to the caller
+    type * release_node(node_container_allocator_type & node_container_allocator, size_type i)
     {
-        node_ptr & p = next->operator[](i);
-        p.reset(n.release());
-        p->prefix = std::move(prefix);
-        p->set_parent(parent_link_type(this, i));
+        return linker_type::resolve(this, next.erase(i, node_container_allocator));
+    }
+
+    static void destroy_node(type * n, node_container_allocator_type & node_container_allocator, node_allocator_type & node_allocator) noexcept
+    {
+        n->clear(node_container_allocator, node_allocator);
+        n->~type();
+        node_allocator.deallocate(n, 1);
+    }
+
+    static void destroy_root(type * n, node_container_allocator_type & node_container_allocator, node_allocator_type & node_allocator) noexcept
+    {
+        n->clear(node_container_allocator, node_allocator);
+        n->~type();
+        root_allocator_type root_allocator = linker_type::root_allocator(node_allocator);
+        root_allocator.deallocate(n, 1);
     }
 
     bool is_leaf() const noexcept
     {
-        return nb_sub_node == 0;
+        return next.empty();
     }
 
     bool empty() const noexcept
     {
-        return nb_sub_node == 0 && !value;
+        return next.empty() && !value;
+    }
+
+    size_type nb_sub_node() const noexcept
+    {
+        return next.size();
     }
 
     value_holder_ptr & get_value() noexcept
@@ -435,29 +1336,106 @@ public:
         return value;
     }
 
-    node_ptr & get_next(size_type i, node_ptr & empty_pair) noexcept
+    // take v when the node has no value yet and count it in every ancestor, v is left untouched otherwise
+    bool set_value(value_holder_ptr & v) noexcept
     {
-        return next ? next->operator[](i) : empty_pair;
+        if(value)
+        {
+            return false;
+        }
+        value.reset(v.release());
+        for(type * ancestor = this; ancestor; ancestor = ancestor->get_parent().first)
+        {
+            ++ancestor->entries;
+        }
+        if constexpr(score_cache_type::scored)
+        {
+            auto score = score_cache_type::score(storage_type::value(*value));
+            for(type * ancestor = this; ancestor && ancestor->best < score; ancestor = ancestor->get_parent().first)
+            {
+                ancestor->best = score;
+            }
+        }
+        return true;
+    }
+
+    // remove the value of the node, its ownership goes to the caller
+    value_holder_ptr take_value() noexcept
+    {
+        value_holder_ptr result(std::move(value));
+        if(result)
+        {
+            for(type * ancestor = this; ancestor; ancestor = ancestor->get_parent().first)
+            {
+                --ancestor->entries;
+            }
+            update_score();
+        }
+        return result;
+    }
+
+    // recompute the best score of the node and of its ancestors, after the score of its value changed
+    void update_score() noexcept
+    {
+        if constexpr(score_cache_type::scored)
+        {
+            for(type * n = this; n; n = n->get_parent().first)
+            {
+                auto best = n->value ? score_cache_type::score(storage_type::value(*n->value)) : score_cache_type::lowest();
+                for(iterator it = n->begin(), last = n->end(); it != last; ++it)
+                {
+                    best = std::max(best, (*it)->best);
+                }
+                if(best == n->best)
+                {
+                    break;
+                }
+                n->best = best;
+            }
+        }
+    }
+
+    // number of values held by the node and its sub nodes
+    size_type subtree_size() const noexcept
+    {
+        return entries;
+    }
+
+    // bring the prefix letters to the cache
+    void prefetch_prefix() const noexcept
+    {
+        if(prefix.begin() != prefix.end())
+        {
+            prefetch_read(&*prefix.begin());
+        }
+    }
+
+    // bring what get_next(i) reads to the cache
+    void prefetch_next(size_type i) const noexcept
+    {
+        next.prefetch(i);
     }
 
-    iterator begin() noexcept
+    type * get_next(size_type i) const noexcept
     {
-        return next ? next->begin() : nullptr;
+        slot_type s = next.find(i);
+        return s ? linker_type::resolve(this, s) : nullptr;
     }
 
-    const_iterator begin() const noexcept
+    iterator begin() const noexcept
     {
-        return next ? next->begin() : nullptr;
+        return iterator(this, next.begin());
     }
 
-    iterator end() noexcept
+    iterator end() const noexcept
     {
-        return next ? next->end() : nullptr;
+        return iterator(this, next.end());
     }
 
-    const_iterator end() const noexcept
+    // first sub node whose index is not less than i
+    iterator lower_bound(size_type i) const noexcept
     {
-        return next ? next->end() : nullptr;
+        return iterator(this, next.lower_bound(i));
     }
 
     prefix_const_iterator prefix_begin() const
@@ -470,25 +1448,78 @@ public:
         return this->prefix.end();
     }
 
-    void clear() noexcept
+    void clear(node_container_allocator_type & node_container_allocator, node_allocator_type & node_allocator) noexcept
     {
         value.reset();
-        if(next)
+        entries = 0;
+        if constexpr(score_cache_type::scored)
+        {
+            this->best = score_cache_type::lowest();
+        }
+        for(iterator it = begin(), last = end(); it != last; ++it)
         {
-            for (node_ptr &n : *next.get())
+            destroy_node(*it, node_container_allocator, node_allocator);
+        }
+        next.clear(node_container_allocator);
+    }
+
+    // clear for allocators owned by the tree and reset right after: sub nodes are destroyed but what
+    // the allocators release in bulk is not deallocated (see bulk_released). Nothing is visited when
+    // no destructor frees memory elsewhere (keys, values, prefixes, blocks too large for the arena).
+    void drop(node_container_allocator_type & node_container_allocator, node_allocator_type & node_allocator) noexcept
+    {
+        drop_value();
+        entries = 0;
+        if constexpr(score_cache_type::scored)
+        {
+            this->best = score_cache_type::lowest();
+        }
+        if constexpr(!trivially_dropped())
+        {
+            for(iterator it = begin(), last = end(); it != last; ++it)
             {
-                n.reset();
+                drop_node(*it, node_container_allocator, node_allocator);
             }
-            next.reset();
         }
-        nb_sub_node = 0;
+        next.drop(node_container_allocator);
     }
+
 private:
-    parent_link_type parent_link;
-    node_container_ptr next;
+    static constexpr bool trivially_dropped() noexcept
+    {
+        return bulk_released<node_allocator_type>::value && bulk_released<value_holder_allocator_type>::value
+            && node_container::template blocks_bulk_released<node_container_allocator_type>()
+            && std::is_trivially_destructible<value_holder>::value && std::is_trivially_destructible<prefix_type>::value;
+    }
+
+    static void drop_node(type * n, node_container_allocator_type & node_container_allocator, node_allocator_type & node_allocator) noexcept
+    {
+        n->drop(node_container_allocator, node_allocator);
+        n->~type();
+        drop_allocation(node_allocator, n);
+    }
+
+    void drop_value() noexcept
+    {
+        if constexpr(bulk_released<value_holder_allocator_type>::value)
+        {
+            value_holder * v = value.release();
+            if(v)
+            {
+                v->~value_holder();
+            }
+        }
+        else
+        {
+            value.reset();
+        }
+    }
+
+    typename linker_type::parent_storage_type parent_link;
+    node_container next;
+    size_type entries;
     value_holder_ptr value;
     prefix_type prefix;
-    size_t nb_sub_node;
 };
 
 #endif //PREFIX_TREE_NODE_H
@@ -0,0 +1,608 @@
+#ifndef PREFIX_TREE_NODE_CONTAINER_H
+#define PREFIX_TREE_NODE_CONTAINER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <new>
+
+#include "util/memory.h"
+#include "util/prefetch.h"
+
+// Children of a node, stored in the smallest of 4 block classes able to hold them (ART style):
+// - 4 and 16 slots with a sorted array of labels,
+// - 48 slots with a label -> slot index of charset size,
+// - one slot per letter of the charset.
+// The block is grown and shrunk as children are inserted and erased. Children are identified by
+// their charset index and visited in index order.
+template<typename Slot, std::size_t N>
+class adaptive_node_container
+{
+public:
+    typedef std::size_t size_type;
+    typedef Slot slot_type;
+    typedef adaptive_node_container<slot_type, N> type;
+    typedef typename std::conditional<(N <= 256), unsigned char, std::uint32_t>::type label_type;
+
+    static constexpr size_type size_max = N;
+
+    enum kind_type : unsigned char
+    {
+        kind_none,
+        kind_4,
+        kind_16,
+        kind_48,
+        kind_full
+    };
+
+    template<size_type Capacity>
+    struct sorted_block
+    {
+        label_type labels[Capacity];
+        slot_type slots[Capacity];
+    };
+
+    struct indexed_block
+    {
+        unsigned char index[N];
+        slot_type slots[48];
+    };
+
+    struct direct_block
+    {
+        slot_type slots[N];
+    };
+
+    typedef sorted_block<4> block_4;
+    typedef sorted_block<16> block_16;
+    typedef indexed_block block_48;
+    typedef direct_block block_full;
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef slot_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const slot_type * pointer;
+        typedef const slot_type & reference;
+
+        const_iterator() noexcept
+        :container(nullptr)
+        ,pos(0)
+        {
+        }
+
+        const_iterator(const type * container, size_type pos) noexcept
+        :container(container)
+        ,pos(pos)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return container->slot_at(pos);
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &container->slot_at(pos);
+        }
+
+        const_iterator & operator++() noexcept
+        {
+            pos = container->next_position(pos + 1);
+            return *this;
+        }
+
+        bool operator==(const const_iterator & right) const noexcept
+        {
+            return pos == right.pos;
+        }
+
+        bool operator!=(const const_iterator & right) const noexcept
+        {
+            return pos != right.pos;
+        }
+
+        // charset index of the child
+        size_type index() const noexcept
+        {
+            return container->index_at(pos);
+        }
+
+    private:
+        const type * container;
+        size_type pos;
+    };
+
+    adaptive_node_container() noexcept
+    :block(nullptr)
+    ,count(0)
+    ,kind(kind_none)
+    {
+    }
+
+    adaptive_node_container(const adaptive_node_container &) = delete;
+    adaptive_node_container & operator=(const adaptive_node_container &) = delete;
+
+    size_type size() const noexcept
+    {
+        return count;
+    }
+
+    bool empty() const noexcept
+    {
+        return count == 0;
+    }
+
+    kind_type get_kind() const noexcept
+    {
+        return kind;
+    }
+
+    slot_type find(size_type i) const noexcept
+    {
+        const slot_type * s = find_slot(i);
+        return s ? *s : slot_type();
+    }
+
+    const slot_type * find_slot(size_type i) const noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+            return find_sorted(static_cast<const block_4 *>(block), i);
+        case kind_16:
+            return find_sorted(static_cast<const block_16 *>(block), i);
+        case kind_48:
+        {
+            const block_48 * b = static_cast<const block_48 *>(block);
+            return b->index[i] ? &b->slots[b->index[i] - 1] : nullptr;
+        }
+        case kind_full:
+        {
+            const block_full * b = static_cast<const block_full *>(block);
+            return b->slots[i] ? &b->slots[i] : nullptr;
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    // bring the memory find reads for index i to the cache: the labels and slots of sorted blocks,
+    // the index entry of 48 slots blocks and the slot itself for full blocks
+    void prefetch(size_type i) const noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+            prefetch_read(block, sizeof(block_4));
+            break;
+        case kind_16:
+            prefetch_read(block, sizeof(block_16));
+            break;
+        case kind_48:
+            prefetch_read(&static_cast<const block_48 *>(block)->index[i]);
+            break;
+        case kind_full:
+            prefetch_read(&static_cast<const block_full *>(block)->slots[i]);
+            break;
+        default:
+            break;
+        }
+    }
+
+    slot_type * find_slot(size_type i) noexcept
+    {
+        return const_cast<slot_type *>(static_cast<const type *>(this)->find_slot(i));
+    }
+
+    // i must not be present yet
+    template<class Allocator>
+    void insert(size_type i, slot_type s, Allocator & allocator)
+    {
+        if(count == capacity(kind))
+        {
+            resize(fitting(count + 1), allocator);
+        }
+        switch(kind)
+        {
+        case kind_4:
+            insert_sorted(static_cast<block_4 *>(block), i, s);
+            break;
+        case kind_16:
+            insert_sorted(static_cast<block_16 *>(block), i, s);
+            break;
+        case kind_48:
+        {
+            block_48 * b = static_cast<block_48 *>(block);
+            size_type free_slot = 0;
+            for(; b->slots[free_slot]; ++free_slot);
+            b->slots[free_slot] = s;
+            b->index[i] = (unsigned char)(free_slot + 1);
+            break;
+        }
+        default:
+            static_cast<block_full *>(block)->slots[i] = s;
+            break;
+        }
+        ++count;
+    }
+
+    // replace the child at i, which must be present, and return the previous one
+    slot_type replace(size_type i, slot_type s) noexcept
+    {
+        slot_type * p = find_slot(i);
+        slot_type result = *p;
+        *p = s;
+        return result;
+    }
+
+    // remove the child at i, which must be present, and return it
+    template<class Allocator>
+    slot_type erase(size_type i, Allocator & allocator)
+    {
+        slot_type result = slot_type();
+        switch(kind)
+        {
+        case kind_4:
+            result = erase_sorted(static_cast<block_4 *>(block), i);
+            break;
+        case kind_16:
+            result = erase_sorted(static_cast<block_16 *>(block), i);
+            break;
+        case kind_48:
+        {
+            block_48 * b = static_cast<block_48 *>(block);
+            slot_type & s = b->slots[b->index[i] - 1];
+            result = s;
+            s = slot_type();
+            b->index[i] = 0;
+            break;
+        }
+        default:
+        {
+            slot_type & s = static_cast<block_full *>(block)->slots[i];
+            result = s;
+            s = slot_type();
+            break;
+        }
+        }
+        --count;
+        kind_type smaller = fitting(count);
+        if(!count)
+        {
+            release(allocator);
+        }
+        else if(smaller < kind && count <= capacity(smaller) - capacity(smaller) / 4)
+        {
+            resize(smaller, allocator);
+        }
+        return result;
+    }
+
+    // free the block, children must have been released by the caller
+    template<class Allocator>
+    void clear(Allocator & allocator) noexcept
+    {
+        release(allocator);
+        count = 0;
+    }
+
+    // forget the block, leaving it to the allocator when it releases its blocks in bulk (see bulk_released)
+    template<class Allocator>
+    void drop(Allocator & allocator) noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+            drop_block<block_4>(block, allocator);
+            break;
+        case kind_16:
+            drop_block<block_16>(block, allocator);
+            break;
+        case kind_48:
+            drop_block<block_48>(block, allocator);
+            break;
+        case kind_full:
+            drop_block<block_full>(block, allocator);
+            break;
+        default:
+            break;
+        }
+        block = nullptr;
+        kind = kind_none;
+        count = 0;
+    }
+
+    // whether drop never has to deallocate a block
+    template<class Allocator>
+    static constexpr bool blocks_bulk_released() noexcept
+    {
+        return bulk_released<rebind<Allocator, block_4> >::value && bulk_released<rebind<Allocator, block_16> >::value
+            && bulk_released<rebind<Allocator, block_48> >::value && bulk_released<rebind<Allocator, block_full> >::value;
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(this, next_position(0));
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(this, end_position());
+    }
+
+    // first child whose index is not less than i
+    const_iterator lower_bound(size_type i) const noexcept
+    {
+        size_type pos = 0;
+        switch(kind)
+        {
+        case kind_4:
+            pos = lower_sorted(static_cast<const block_4 *>(block), i);
+            break;
+        case kind_16:
+            pos = lower_sorted(static_cast<const block_16 *>(block), i);
+            break;
+        case kind_none:
+            break;
+        default:
+            pos = next_position(i);
+            break;
+        }
+        return const_iterator(this, pos);
+    }
+
+private:
+    static constexpr size_type capacity(kind_type k) noexcept
+    {
+        return k == kind_4 ? 4 : k == kind_16 ? 16 : k == kind_48 ? 48 : k == kind_full ? N : 0;
+    }
+
+    // smallest block class able to hold n children, classes at least as large as the charset are skipped
+    static constexpr kind_type fitting(size_type n) noexcept
+    {
+        return n == 0 ? kind_none
+             : n <= 4 && 4 < N ? kind_4
+             : n <= 16 && 16 < N ? kind_16
+             : n <= 48 && 48 < N ? kind_48
+             : kind_full;
+    }
+
+    template<size_type Capacity>
+    size_type sorted_position(const sorted_block<Capacity> * b, size_type i) const noexcept
+    {
+        size_type pos = 0;
+        for(; pos != count && b->labels[pos] < i; ++pos);
+        return pos;
+    }
+
+    template<size_type Capacity>
+    const slot_type * find_sorted(const sorted_block<Capacity> * b, size_type i) const noexcept
+    {
+        size_type pos = sorted_position(b, i);
+        return pos != count && b->labels[pos] == i ? &b->slots[pos] : nullptr;
+    }
+
+    template<size_type Capacity>
+    size_type lower_sorted(const sorted_block<Capacity> * b, size_type i) const noexcept
+    {
+        return sorted_position(b, i);
+    }
+
+    template<size_type Capacity>
+    void insert_sorted(sorted_block<Capacity> * b, size_type i, slot_type s) noexcept
+    {
+        size_type pos = sorted_position(b, i);
+        for(size_type j = count; j != pos; --j)
+        {
+            b->labels[j] = b->labels[j - 1];
+            b->slots[j] = b->slots[j - 1];
+        }
+        b->labels[pos] = (label_type)i;
+        b->slots[pos] = s;
+    }
+
+    template<size_type Capacity>
+    slot_type erase_sorted(sorted_block<Capacity> * b, size_type i) noexcept
+    {
+        size_type pos = sorted_position(b, i);
+        slot_type result = b->slots[pos];
+        for(size_type j = pos + 1; j != count; ++j)
+        {
+            b->labels[j - 1] = b->labels[j];
+            b->slots[j - 1] = b->slots[j];
+        }
+        b->slots[count - 1] = slot_type();
+        return result;
+    }
+
+    // positions are slot positions for sorted blocks and charset indexes for the others
+    size_type next_position(size_type pos) const noexcept
+    {
+        switch(kind)
+        {
+        case kind_48:
+        {
+            const block_48 * b = static_cast<const block_48 *>(block);
+            for(; pos != N && !b->index[pos]; ++pos);
+            return pos;
+        }
+        case kind_full:
+        {
+            const block_full * b = static_cast<const block_full *>(block);
+            for(; pos != N && !b->slots[pos]; ++pos);
+            return pos;
+        }
+        default:
+            return pos < count ? pos : count;
+        }
+    }
+
+    size_type end_position() const noexcept
+    {
+        return kind == kind_48 || kind == kind_full ? N : count;
+    }
+
+    const slot_type & slot_at(size_type pos) const noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+            return static_cast<const block_4 *>(block)->slots[pos];
+        case kind_16:
+            return static_cast<const block_16 *>(block)->slots[pos];
+        case kind_48:
+        {
+            const block_48 * b = static_cast<const block_48 *>(block);
+            return b->slots[b->index[pos] - 1];
+        }
+        default:
+            return static_cast<const block_full *>(block)->slots[pos];
+        }
+    }
+
+    size_type index_at(size_type pos) const noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+            return static_cast<const block_4 *>(block)->labels[pos];
+        case kind_16:
+            return static_cast<const block_16 *>(block)->labels[pos];
+        default:
+            return pos;
+        }
+    }
+
+    template<typename Block, class Allocator>
+    static Block * allocate_block(Allocator & allocator)
+    {
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Block> block_allocator(allocator);
+        Block * b = block_allocator.allocate(1);
+        new((void *)b) Block();
+        return b;
+    }
+
+    template<typename Block, class Allocator>
+    static void deallocate_block(void * b, Allocator & allocator) noexcept
+    {
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Block> block_allocator(allocator);
+        static_cast<Block *>(b)->~Block();
+        block_allocator.deallocate(static_cast<Block *>(b), 1);
+    }
+
+    template<class Allocator, typename Block>
+    using rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+
+    template<typename Block, class Allocator>
+    static void drop_block(void * b, Allocator & allocator) noexcept
+    {
+        if constexpr(!bulk_released<rebind<Allocator, Block> >::value)
+        {
+            deallocate_block<Block>(b, allocator);
+        }
+    }
+
+    template<class Allocator>
+    void * allocate_kind(kind_type k, Allocator & allocator)
+    {
+        switch(k)
+        {
+        case kind_4:
+            return allocate_block<block_4>(allocator);
+        case kind_16:
+            return allocate_block<block_16>(allocator);
+        case kind_48:
+            return allocate_block<block_48>(allocator);
+        case kind_full:
+            return allocate_block<block_full>(allocator);
+        default:
+            return nullptr;
+        }
+    }
+
+    template<class Allocator>
+    void release(Allocator & allocator) noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+            deallocate_block<block_4>(block, allocator);
+            break;
+        case kind_16:
+            deallocate_block<block_16>(block, allocator);
+            break;
+        case kind_48:
+            deallocate_block<block_48>(block, allocator);
+            break;
+        case kind_full:
+            deallocate_block<block_full>(block, allocator);
+            break;
+        default:
+            break;
+        }
+        block = nullptr;
+        kind = kind_none;
+    }
+
+    // move the children to a block of class k, they are copied in index order
+    template<class Allocator>
+    void resize(kind_type k, Allocator & allocator)
+    {
+        type resized;
+        resized.block = allocate_kind(k, allocator);
+        resized.kind = k;
+        for(const_iterator it = begin(), last = end(); it != last; ++it)
+        {
+            resized.append(it.index(), *it);
+        }
+        release(allocator);
+        block = resized.block;
+        kind = resized.kind;
+        resized.block = nullptr;
+        resized.kind = kind_none;
+    }
+
+    // insert a child whose index is greater than every index already present, block has room for it
+    void append(size_type i, slot_type s) noexcept
+    {
+        switch(kind)
+        {
+        case kind_4:
+        {
+            block_4 * b = static_cast<block_4 *>(block);
+            b->labels[count] = (label_type)i;
+            b->slots[count] = s;
+            break;
+        }
+        case kind_16:
+        {
+            block_16 * b = static_cast<block_16 *>(block);
+            b->labels[count] = (label_type)i;
+            b->slots[count] = s;
+            break;
+        }
+        case kind_48:
+        {
+            block_48 * b = static_cast<block_48 *>(block);
+            b->slots[count] = s;
+            b->index[i] = (unsigned char)(count + 1);
+            break;
+        }
+        default:
+            static_cast<block_full *>(block)->slots[i] = s;
+            break;
+        }
+        ++count;
+    }
+
+    void * block;
+    std::uint32_t count;
+    kind_type kind;
+};
+
+#endif //PREFIX_TREE_NODE_CONTAINER_H
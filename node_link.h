@@ -0,0 +1,108 @@
+#ifndef PREFIX_TREE_NODE_LINK_H
+#define PREFIX_TREE_NODE_LINK_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "util/types.h"
+#include "util/node_pool.h"
+
+// How a node refers to its sub nodes and to its parent.
+// pointer_link: plain node pointers, nodes come from the tree allocator.
+// handle_link: 32 bits handles into a node_pool, child slots are 4 bytes and the parent link 8 bytes.
+template<typename Node, typename Link>
+struct linker;
+
+template<typename Node>
+struct linker<Node, pointer_link>
+{
+    typedef Node node_type;
+    typedef std::size_t size_type;
+    typedef linker<node_type, pointer_link> type;
+    typedef node_type * slot_type;
+    typedef std::pair<node_type *, size_type> parent_link_type;
+    typedef parent_link_type parent_storage_type;
+    typedef const parent_link_type & parent_reference;
+
+    template<class Allocator>
+    using node_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<node_type>;
+
+    // roots are not taken from the tree allocator, an arena is thus empty once the tree is cleared
+    template<class NodeAllocator>
+    static std::allocator<node_type> root_allocator(NodeAllocator &) noexcept
+    {
+        return std::allocator<node_type>();
+    }
+
+    static node_type * resolve(const node_type * owner, slot_type s) noexcept
+    {
+        return s;
+    }
+
+    static slot_type slot(node_type * n) noexcept
+    {
+        return n;
+    }
+
+    static parent_reference parent(const parent_storage_type & link, const node_type * self) noexcept
+    {
+        return link;
+    }
+
+    static void set_parent(parent_storage_type & link, parent_link_type && parent) noexcept
+    {
+        link = std::move(parent);
+    }
+};
+
+template<typename Node>
+struct linker<Node, handle_link>
+{
+    typedef Node node_type;
+    typedef std::size_t size_type;
+    typedef linker<node_type, handle_link> type;
+    typedef node_pool<node_type> pool_type;
+    typedef typename pool_type::handle_type slot_type;
+    typedef std::pair<node_type *, size_type> parent_link_type;
+    typedef parent_link_type parent_reference;
+
+    struct parent_storage_type
+    {
+        slot_type parent;
+        slot_type index;
+    };
+
+    template<class Allocator>
+    using node_allocator_type = pool_allocator<node_type>;
+
+    // roots live in the pool as well, their sub nodes refer to them by handle
+    template<class NodeAllocator>
+    static NodeAllocator root_allocator(NodeAllocator & node_allocator) noexcept
+    {
+        return node_allocator;
+    }
+
+    static node_type * resolve(const node_type * owner, slot_type s) noexcept
+    {
+        return pool_type::of(owner)->get(s);
+    }
+
+    static slot_type slot(node_type * n) noexcept
+    {
+        return pool_type::handle_of(n);
+    }
+
+    static parent_reference parent(const parent_storage_type & link, const node_type * self) noexcept
+    {
+        return parent_link_type(link.parent ? resolve(self, link.parent) : nullptr, link.index);
+    }
+
+    static void set_parent(parent_storage_type & link, parent_link_type && parent) noexcept
+    {
+        link.parent = parent.first ? slot(parent.first) : 0;
+        link.index = (slot_type)parent.second;
+    }
+};
+
+#endif //PREFIX_TREE_NODE_LINK_H
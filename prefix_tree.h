@@ -8,11 +8,28 @@
 #include <memory>
 #include <utility>
 #include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "util/memory.h"
+#include "util/arena_allocator.h"
+#include "util/key_range.h"
 #include "node.h"
 #include "iterator.h"
 #include "prefixer_traits.h"
+#include "value_storage.h"
+#include "frozen_prefix_tree.h"
+#include "snapshot.h"
+#include "louds_prefix_tree.h"
+#include "aho_corasick_scanner.h"
 
 template<class K, class T, class Charset, class Allocator = std::allocator<T> >
 class prefix_tree_view
@@ -20,7 +37,7 @@ class prefix_tree_view
 
 };
 
-template<class K, class T, class Charset, class Prefixer, class Allocator = std::allocator<T> >
+template<class K, class T, class Charset, class Prefixer, class Allocator = std::allocator<T>, class Link = pointer_link, class Storage = keyed_value, class Score = no_score>
 class prefix_tree
 {
 public:
@@ -31,18 +48,23 @@ public:
     typedef Charset charset_type;
     typedef Prefixer prefixer_type;
     typedef Allocator allocator_type;
-    typedef prefix_tree<key_type,mapped_type,charset_type,prefixer_type,allocator_type> type;
+    typedef Link link_type;
+    typedef Storage storage_tag;
+    typedef Score score_tag;
+    typedef prefix_tree<key_type,mapped_type,charset_type,prefixer_type,allocator_type,link_type,storage_tag,score_tag> type;
     typedef mapped_type value_type;
 
     typedef typename charset_type::index_type index_type;
     typedef typename charset_type::letter_type letter_type;
 
-    typedef node<key_type, mapped_type, charset_type, prefixer_type, allocator_type> node_type;
+    typedef node<key_type, mapped_type, charset_type, prefixer_type, allocator_type, link_type, storage_tag, score_tag> node_type;
+    typedef typename node_type::storage_type storage_type;
     typedef typename node_type::parent_link_type parent_link_type;
     typedef typename node_type::node_container node_container;
     typedef typename node_type::prefix_const_iterator prefix_const_iterator;
+    typedef typename node_type::key_const_iterator key_const_iterator;
 
-    typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<node_type> node_allocator_type;
+    typedef typename node_type::node_allocator_type node_allocator_type;
     typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<index_type> prefix_allocator_type;
     typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<node_container> node_container_allocator_type;
     typedef typename node_type::value_holder value_holder;
@@ -56,100 +78,168 @@ public:
     typedef prefix_tree_iterator<node_type, readonly_type> const_iterator;
     typedef prefix_tree_iterator<node_type, readwrite_type> iterator;
 
+    // lookups take keys as any range of letters, such as string views or C strings, see key_range
+    template<class Key>
+    using if_key = typename std::enable_if<key_range<letter_type, Key>::value, int>::type;
+
     explicit prefix_tree(const charset_type & abc = charset_type(), const allocator_type & allocator = allocator_type())
     :abc(abc)
     ,allocator(allocator)
     ,node_allocator(this->allocator)
     ,prefix_allocator(this->allocator)
-    ,root(parent_link_type(nullptr,0), value_holder_ptr(nullptr, value_holder_deleter_type(this->allocator)), this->node_allocator)
+    ,node_container_allocator(this->allocator)
+    ,root(make_root())
+    {
+    }
+
+    // build from (key, value) pairs, see bulk_load
+    template<class InputIterator>
+    prefix_tree(InputIterator first, InputIterator last, const charset_type & abc = charset_type(), const allocator_type & allocator = allocator_type())
+    :prefix_tree(abc, allocator)
+    {
+        bulk_load(first, last);
+    }
+
+    prefix_tree(const prefix_tree &) = delete;
+    prefix_tree & operator=(const prefix_tree &) = delete;
+
+    ~prefix_tree() noexcept
     {
+        clear();
+        node_type::destroy_root(root, this->node_container_allocator, this->node_allocator);
     }
 	
-    reference at(const key_type & key) const
+    template<class Key, if_key<Key> = 0>
+    reference at(const Key & key) const
     {
-        const node_type * node = exact_match(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end()));
+        const node_type * node = exact_match(get_node(root, key));
         if(!node)
         {
             throw std::out_of_range("key not found");
         }
         else
         {
-            return node->get_value()->second;
+            return storage_type::value(*node->get_value());
         }
     }
 
-    reference at(const key_type & key)
+    template<class Key, if_key<Key> = 0>
+    reference at(const Key & key)
     {
-        const node_type * node = exact_match(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end()));
+        const node_type * node = exact_match(get_node(root, key));
         if(!node)
         {
             throw std::out_of_range("key not found");
         }
         else
         {
-            return node->get_value()->second;
+            return storage_type::value(*node->get_value());
         }
     }
 
     reference operator[] ( const key_type & k)
     {
-        unique_allocation a(this->allocator, 1);
-        new((void *)a.get()) value_holder(k, mapped_type());
-        value_holder_ptr value(a.release(), value_holder_deleter_type(this->allocator));
-
-        node_type * node = insert_node<node_type>(&this->root, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, value->first, value->first.begin(), value->first.end());
-        value_holder_ptr & existing = node->get_value();
-        if(!existing)
-        {
-            existing.reset(value.release());
-        }
-        return existing->second;
+        return storage_type::value(*emplace_value(k).first->get_value());
     }
 
     std::pair<iterator, bool> insert(const key_type & k, const mapped_type & toInsert)
     {
-        unique_allocation a(this->allocator, 1);
-        new((void *)a.get()) value_holder(k, mapped_type());
-        value_holder_ptr value(a.release(), value_holder_deleter_type(this->allocator));
-
-        node_type * node = insert_node<node_type>(&this->root, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, value->first, value->first.begin(), value->first.end());
-        value_holder_ptr & existing = node->get_value();
-        if(!existing)
-        {
-            existing.reset(value.release());
-        }
-        return std::make_pair(iterator(node), value.get() == nullptr);
+        return try_emplace(k, toInsert);
     }
 
     std::pair<iterator, bool> insert(const key_type & k, mapped_type && toInsert)
     {
-        unique_allocation a(this->allocator, 1);
-        new((void *)a.get()) value_holder(k, std::forward<mapped_type>(toInsert));
-        value_holder_ptr value(a.release(), value_holder_deleter_type(this->allocator));
+        return try_emplace(k, std::forward<mapped_type>(toInsert));
+    }
 
-        node_type * node = insert_node<node_type>(&this->root, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, value->first, value->first.begin(), value->first.end());
-        value_holder_ptr & existing = node->get_value();
-        if(!existing)
+    template <typename P>
+    std::pair<iterator, bool> insert(const key_type & k, P && toInsert)
+    {
+        return try_emplace(k, std::forward<P>(toInsert));
+    }
+
+    // value of k built from args when k has none, nothing is allocated nor built when it has one
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type & k, Args &&... args)
+    {
+        std::pair<node_type *, bool> result = emplace_value(k, std::forward<Args>(args)...);
+        return std::make_pair(iterator::make_begin(result.first, &abc), result.second);
+    }
+
+    // as try_emplace, the key is given apart from the arguments of the value
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(const key_type & k, Args &&... args)
+    {
+        return try_emplace(k, std::forward<Args>(args)...);
+    }
+
+    // assign obj to the value of k, or insert it when k has none. Only an insertion allocates.
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type & k, M && obj)
+    {
+        std::pair<node_type *, bool> result = emplace_value(k, std::forward<M>(obj));
+        if(!result.second)
         {
-            existing.reset(value.release());
+            storage_type::value(*result.first->get_value()) = std::forward<M>(obj);
+            result.first->update_score();
         }
-        return std::make_pair(iterator::make_begin(node), value.get() == nullptr);
+        return std::make_pair(iterator::make_begin(result.first, &abc), result.second);
     }
 
-    template <typename P>
-    std::pair<iterator, bool> insert(const key_type & k, P && toInsert)
+    // as insert, the walk starts from the deepest node shared by the paths of k and of the key of hint
+    // instead of the root, so sorted or clustered keys only walk the letters they do not share with the
+    // previous one when the returned iterator is given as hint for the next key. A hint without entry,
+    // such as end(), starts from the root.
+    iterator insert(const_iterator hint, const key_type & k, const mapped_type & toInsert)
     {
-        unique_allocation a(this->allocator, 1);
-        new((void *)a.get()) value_holder(k, std::forward<P>(toInsert));
-        value_holder_ptr value(a.release(), value_holder_deleter_type(this->allocator));
+        return iterator::make_begin(emplace_value(hint, k, toInsert).first, &abc);
+    }
 
-        node_type * node = insert_node<node_type>(&this->root, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, value->first, value->first.begin(), value->first.end());
-        value_holder_ptr & existing = node->get_value();
-        if(!existing)
+    iterator insert(const_iterator hint, const key_type & k, mapped_type && toInsert)
+    {
+        return iterator::make_begin(emplace_value(hint, k, std::forward<mapped_type>(toInsert)).first, &abc);
+    }
+
+    // insert (key, value) pairs. Pairs sorted in charset order are appended to an empty tree in
+    // a single pass, the remaining ones after the first out of order key are inserted one by one.
+    // As with insert, the first value given for a key is kept.
+    template<class InputIterator>
+    void bulk_load(InputIterator first, InputIterator last)
+    {
+        load(root, 0, first, last, [](const InputIterator & it) -> decltype(auto) { return *it; });
+    }
+
+    // insert (key, value) pairs of a forward range with several threads, the tree ends up as if
+    // insert had been called for each pair in order. Pairs are grouped below the nodes where their
+    // keys branch off, until groups are small enough to be spread over the threads. Each group is
+    // loaded below a detached node then its sub tree is linked to the tree.
+    // Allocators which cannot be shared between threads (see concurrent_allocator), prefixes
+    // sharing memory with the stored keys and non empty trees fall back to bulk_load.
+    template<class ForwardIterator>
+    void parallel_load(ForwardIterator first, ForwardIterator last, size_type threads = std::thread::hardware_concurrency())
+    {
+        constexpr bool concurrent = concurrent_allocator<value_holder_allocator_type>::value
+                                    && concurrent_allocator<node_allocator_type>::value
+                                    && concurrent_allocator<node_container_allocator_type>::value
+                                    && std::is_same<typename prefixer_type::prefix_life_cycle_traits, own_memory>::value;
+        if constexpr(concurrent)
         {
-            existing.reset(value.release());
+            if(empty() && threads > 1)
+            {
+                typedef const typename std::iterator_traits<ForwardIterator>::value_type * pair_ptr;
+                std::vector<pair_ptr> pairs;
+                for(; first != last; ++first)
+                {
+                    pairs.push_back(&*first);
+                }
+                std::vector<load_group<pair_ptr> > groups;
+                std::vector<pair_ptr> scratch(pairs.size());
+                partition(root, 0, pairs.data(), pairs.data() + pairs.size(), scratch.data(), pairs.size() / (threads * 4) + 1, groups);
+                load_groups(groups, threads);
+                return;
+            }
         }
-        return std::make_pair(iterator::make_begin(node), value.get() == nullptr);
+        bulk_load(first, last);
     }
 
 	const_iterator erase(const_iterator pos)
@@ -158,7 +248,7 @@ public:
 		if(to_erase)
 		{
 		    ++pos;
-            remove_node<node_type>(to_erase, this->prefix_allocator);
+            remove_node<node_type>(to_erase, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc);
 		}
 		return pos;
 	}
@@ -169,7 +259,7 @@ public:
         if(to_erase)
         {
             ++pos;
-            remove_node<node_type>(to_erase, this->prefix_allocator);
+            remove_node<node_type>(to_erase, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc);
         }
         return pos;
 	}
@@ -192,13 +282,14 @@ public:
 		return first;
 	}
 	
-	size_type erase( const key_type& key )
+    template<class Key, if_key<Key> = 0>
+	size_type erase( const Key & key )
 	{
         size_type result = 0;
-        node_type * node = exact_match(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end()));
+        node_type * node = exact_match(get_node(root, key));
 		if(node)
 		{
-            remove_node<node_type>(node, this->prefix_allocator);
+            remove_node<node_type>(node, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc);
 			result = size_type(1);
 		}
 		return result;
@@ -206,32 +297,32 @@ public:
 	
 	iterator begin() noexcept
     {
-        return iterator::make_begin(&root);
+        return iterator::make_begin(root, &abc);
     }
 	
     const_iterator begin() const noexcept
     {
-        return const_iterator::make_begin(&root);
+        return const_iterator::make_begin(root, &abc);
     }
 	
     const_iterator cbegin() const noexcept
     {
-        return const_iterator::make_begin(&root);
+        return const_iterator::make_begin(root, &abc);
     }
 	
     iterator end() noexcept
     {
-        return iterator::make_end(&root);
+        return iterator::make_end(root, &abc);
     }
 	
     const_iterator end() const noexcept
     {
-        return const_iterator::make_end(&root);
+        return const_iterator::make_end(root, &abc);
     }
 
     const_iterator cend() const noexcept
     {
-        return const_iterator::make_end(&root);
+        return const_iterator::make_end(root, &abc);
     }
 	
     allocator_type get_allocator() const noexcept
@@ -241,44 +332,64 @@ public:
 
     bool empty() const noexcept
     {
-        return root.empty();
+        return root->empty();
+    }
+
+    size_type size() const noexcept
+    {
+        return root->subtree_size();
     }
 
     void clear() noexcept
     {
-        root.clear();
+        if(owns_memory())
+        {
+            root->drop(this->node_container_allocator, this->node_allocator);
+            allocator_releaser<value_holder_allocator_type>::reset(this->allocator);
+        }
+        else
+        {
+            root->clear(this->node_container_allocator, this->node_allocator);
+            allocator_releaser<value_holder_allocator_type>::release(this->allocator);
+        }
     }
 
-    size_type count( const key_type & key ) const
+    template<class Key, if_key<Key> = 0>
+    size_type count( const Key & key ) const
     {
-        const node_type * node = exact_match(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end()));
+        const node_type * node = exact_match(get_node(root, key));
         return node ? 1 : 0;
     }
 
-    iterator find( const key_type& key )
+    template<class Key, if_key<Key> = 0>
+    iterator find( const Key & key )
     {
-        return iterator::make_begin(exact_match(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end())));
+        return iterator::make_begin(exact_match(get_node(root, key)), &abc);
     }
 
-    const_iterator find( const key_type& key ) const
+    template<class Key, if_key<Key> = 0>
+    const_iterator find( const Key & key ) const
     {
-        return const_iterator::make_begin(exact_match(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end())));
+        return const_iterator::make_begin(exact_match(get_node(root, key)), &abc);
     }
 
-    const_iterator lower_bound( const key_type & key) const
+    template<class Key, if_key<Key> = 0>
+    const_iterator lower_bound( const Key & key) const
     {
-        return const_iterator::make_begin(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end()).second);
+        return const_iterator::make_begin(get_node(root, key).second, &abc);
     }
 
-    iterator lower_bound( const key_type & key)
+    template<class Key, if_key<Key> = 0>
+    iterator lower_bound( const Key & key)
     {
-        return iterator::make_begin(get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end()).second);
+        return iterator::make_begin(get_node(root, key).second, &abc);
     }
 
-    const_iterator upper_bound( const key_type & key) const
+    template<class Key, if_key<Key> = 0>
+    const_iterator upper_bound( const Key & key) const
     {
-        std::pair<prefix_const_iterator, const node_type *> p = get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end());
-        const_iterator result(p.second);
+        std::pair<prefix_const_iterator, const node_type *> p = get_node(root, key);
+        const_iterator result = const_iterator::make_begin(p.second, &abc);
         if(exact_match(p))
         {
             ++result;
@@ -286,10 +397,11 @@ public:
         return result;
     }
 
-    iterator upper_bound( const key_type & key)
+    template<class Key, if_key<Key> = 0>
+    iterator upper_bound( const Key & key)
     {
-        std::pair<prefix_const_iterator, const node_type *> p = get_node<node_type>(root.prefix_begin(), &root, abc, key.begin(), key.end());
-        iterator result(p.second);
+        std::pair<prefix_const_iterator, node_type *> p = get_node(root, key);
+        iterator result = iterator::make_begin(p.second, &abc);
         if(exact_match(p))
         {
             ++result;
@@ -297,23 +409,590 @@ public:
         return result;
     }
 
-    void start_with( key_type & key ) const
+    // write find(key) for each key of [first, last) to out, in input order. The lookups are interleaved
+    // so that the cache misses of several keys overlap, see batch_getter.
+    template<class ForwardIterator, class OutputIterator>
+    OutputIterator find_batch(ForwardIterator first, ForwardIterator last, OutputIterator out) const
+    {
+        for(const node_type * node : exact_nodes(first, last))
+        {
+            *out++ = const_iterator::make_begin(node, &abc);
+        }
+        return out;
+    }
+
+    template<class ForwardIterator, class OutputIterator>
+    OutputIterator find_batch(ForwardIterator first, ForwardIterator last, OutputIterator out)
+    {
+        for(const node_type * node : exact_nodes(first, last))
+        {
+            *out++ = iterator::make_begin(const_cast<node_type *>(node), &abc);
+        }
+        return out;
+    }
+
+    // write count(key) for each key of [first, last) to out, in input order, see find_batch
+    template<class ForwardIterator, class OutputIterator>
+    OutputIterator count_batch(ForwardIterator first, ForwardIterator last, OutputIterator out) const
+    {
+        for(const node_type * node : exact_nodes(first, last))
+        {
+            *out++ = node ? size_type(1) : size_type(0);
+        }
+        return out;
+    }
+
+    // entries whose key starts with prefix. The range is the sub tree of the node prefix ends in,
+    // its iterators never leave that sub tree.
+    template<class Key, if_key<Key> = 0>
+    std::pair<const_iterator, const_iterator> equal_prefix_range( const Key & prefix ) const
+    {
+        const node_type * node = get_node(root, prefix).second;
+        return std::make_pair(const_iterator::make_begin(node, &abc), const_iterator::make_end(node, &abc));
+    }
+
+    template<class Key, if_key<Key> = 0>
+    std::pair<iterator, iterator> equal_prefix_range( const Key & prefix )
+    {
+        node_type * node = get_node(root, prefix).second;
+        return std::make_pair(iterator::make_begin(node, &abc), iterator::make_end(node, &abc));
+    }
+
+    // entry whose key is the longest prefix of key, end() when none of the keys is a prefix of it
+    template<class Key, if_key<Key> = 0>
+    const_iterator longest_prefix_match( const Key & key ) const
+    {
+        return const_iterator::make_begin(longest_prefix_node(key), &abc);
+    }
+
+    template<class Key, if_key<Key> = 0>
+    iterator longest_prefix_match( const Key & key )
+    {
+        return iterator::make_begin(const_cast<node_type *>(longest_prefix_node(key)), &abc);
+    }
+
+    // call f(length, value) for each entry whose key is a prefix of key, from the shortest key to the
+    // longest, length being the number of letters of that key. The walk goes down the tree once.
+    template<class Key, class F, if_key<Key> = 0>
+    void all_prefixes_of( const Key & key, F f ) const
+    {
+        auto letters = key_range<letter_type, Key>::letters(key);
+        getter<const node_type>::visit_prefixes(root, abc, letters.first, letters.second, [&f](const node_type * node, size_type length)
+        {
+            f(length, storage_type::value(*node->get_value()));
+        });
+    }
+
+    template<class Key, class F, if_key<Key> = 0>
+    void all_prefixes_of( const Key & key, F f )
+    {
+        auto letters = key_range<letter_type, Key>::letters(key);
+        getter<node_type>::visit_prefixes(root, abc, letters.first, letters.second, [&f](node_type * node, size_type length)
+        {
+            f(length, storage_type::value(*node->get_value()));
+        });
+    }
+
+    // call f(key, value, d) for each entry whose key is at Levenshtein distance d <= distance of query,
+    // in key order, stopping after limit entries. Returns the number of entries found, see fuzzy_finder.
+    template<class Key, class F, if_key<Key> = 0>
+    size_type fuzzy_find( const Key & query, size_type distance, F f, size_type limit = std::numeric_limits<size_type>::max() ) const
+    {
+        auto letters = key_range<letter_type, Key>::letters(query);
+        fuzzy_finder<const node_type> finder(abc, letters.first, letters.second, distance, limit);
+        return finder.find(root, [&f](const key_type & key, const node_type * node, size_type d)
+        {
+            f(key, storage_type::value(*node->get_value()), d);
+        });
+    }
+
+    // call f(key, value) for each entry whose key matches the glob pattern, in key order. Returns the number
+    // of entries found, see glob_matcher for the syntax.
+    template<class Pattern, class F, if_key<Pattern> = 0>
+    size_type match( const Pattern & pattern, F f ) const
+    {
+        auto letters = key_range<letter_type, Pattern>::letters(pattern);
+        glob_matcher<const node_type> matcher(abc, letters.first, letters.second);
+        return matcher.match(root, [&f](const key_type & key, const node_type * node)
+        {
+            f(key, storage_type::value(*node->get_value()));
+        });
+    }
+
+    // write iterators to the k entries with the best scores among those whose key starts with prefix to
+    // out, by decreasing score. Needs a Score parameter, the scores being kept by the nodes, see top_scorer.
+    template<class Key, class OutputIterator, if_key<Key> = 0>
+    OutputIterator top_k( const Key & prefix, size_type k, OutputIterator out ) const
+    {
+        static_assert(node_type::scored, "top_k needs the Score parameter of the tree");
+        top_scorer<const node_type>::top(get_node(root, prefix).second, k, [this, &out](const node_type * node)
+        {
+            *out++ = const_iterator::make_begin(node, &abc);
+        });
+        return out;
+    }
+
+    // the score of the value of pos has been changed through a reference, update the scores kept by the nodes
+    void rescore( const_iterator pos ) noexcept
+    {
+        const_cast<node_type *>(pos.get_node())->update_score();
+    }
+
+    // number of entries whose key starts with prefix
+    template<class Key, if_key<Key> = 0>
+    size_type count_prefix( const Key & prefix ) const
+    {
+        const node_type * node = get_node(root, prefix).second;
+        return node ? node->subtree_size() : 0;
+    }
+
+    // number of entries whose key is less than key, in iteration order
+    template<class Key, if_key<Key> = 0>
+    size_type rank( const Key & key ) const
+    {
+        auto letters = key_range<letter_type, Key>::letters(key);
+        return ranker<const node_type>::rank(root, abc, letters.first, letters.second);
+    }
+
+    // iterator to the entry of the given rank, end() when there are not that many entries
+    const_iterator select( size_type rank ) const
+    {
+        return const_iterator(ranker<const node_type>::select(root, rank), nullptr, &abc);
+    }
+
+    iterator select( size_type rank )
+    {
+        return iterator(ranker<node_type>::select(root, rank), nullptr, &abc);
+    }
+
+    // write the tree to path in the layout read in place by frozen_prefix_tree
+    void freeze( const std::string & path ) const
+    {
+        freezer<node_type>::freeze(root, path);
+    }
+
+    // read only succinct copy of the tree, see louds_prefix_tree
+    louds_prefix_tree<key_type, mapped_type, charset_type> succinct() const
     {
+        return louds_prefix_tree<key_type, mapped_type, charset_type>::build(root, abc);
+    }
+
+    // Aho-Corasick automaton finding the keys of the tree in a text, see aho_corasick_scanner
+    aho_corasick_scanner<key_type, mapped_type, charset_type> scanner() const
+    {
+        return aho_corasick_scanner<key_type, mapped_type, charset_type>::build(root, abc);
+    }
+
+    // write the entries to out as a snapshot stream, values being written by codec
+    template<class Codec = trivial_codec<mapped_type> >
+    void save( std::ostream & out, Codec codec = Codec() ) const
+    {
+        save_snapshot(*this, out, codec);
+    }
+
+    // insert the entries of a snapshot stream written by save, the tree being built in a single pass when it is
+    // empty. The stream is left right after the end of the snapshot.
+    template<class Codec = trivial_codec<mapped_type> >
+    void load( std::istream & in, Codec codec = Codec() )
+    {
+        load_snapshot(*this, in, codec);
     }
 
 private:
+    // pairs loaded by one thread below the detached node top, then linked as the sub node index of node
+    template<typename PairPtr>
+    struct load_group
+    {
+        node_type * node;
+        size_type index;
+        size_type offset;
+        PairPtr * first;
+        PairPtr * last;
+        node_type * top;
+        std::exception_ptr error;
+    };
+
+    // whether the tree holds every copy of an allocator releasing its memory at once, clear then drops
+    // the nodes without deallocating them
+    bool owns_memory() const noexcept
+    {
+        return allocator_releaser<value_holder_allocator_type>::owned_by(this->allocator, allocator_copies);
+    }
+
+    node_type * make_root()
+    {
+        return node_type::make_root(this->node_allocator, value_holder_ptr(nullptr, value_holder_deleter_type(this->allocator)));
+    }
+
+    template<typename... Args>
+    value_holder_ptr make_value(const key_type & k, Args &&... args)
+    {
+        unique_allocation a(this->allocator, 1);
+        storage_type::construct(a.get(), k, std::forward<Args>(args)...);
+        return value_holder_ptr(a.release(), value_holder_deleter_type(this->allocator));
+    }
+
+    // load the pairs given by get(it) below top, whose path is the offset first letters of their keys:
+    // in a single pass while they come sorted if top is empty, then one by one
+    template<class Iterator, class Get>
+    void load(node_type * top, size_type offset, Iterator first, Iterator last, Get get)
+    {
+        if(top->empty())
+        {
+            appender<node_type> sorted(top, this->node_container_allocator, this->node_allocator, abc);
+            for(; first != last; ++first)
+            {
+                const auto & pair = get(first);
+                value_holder_ptr value = make_value(pair.first, pair.second);
+                const key_type & key = storage_type::stored_key(*value, pair.first);
+
+                node_type * node = sorted.append(key, key.cbegin() + offset);
+                bool in_order = node != nullptr;
+                if(!in_order)
+                {
+                    node = insert_node<node_type>(top, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, key, key.cbegin() + offset, key.cend());
+                }
+                node->set_value(value);
+                if(!in_order)
+                {
+                    ++first;
+                    break;
+                }
+            }
+        }
+        for(; first != last; ++first)
+        {
+            const auto & pair = get(first);
+            value_holder_ptr value = make_value(pair.first, pair.second);
+            const key_type & key = storage_type::stored_key(*value, pair.first);
+
+            node_type * node = insert_node<node_type>(top, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, key, key.cbegin() + offset, key.cend());
+            node->set_value(value);
+        }
+    }
+
+    // split the pairs whose keys start with the path to n, ending at offset, by their letter at offset.
+    // Keys ending at offset go to n, groups larger than grain get their own node and are split again.
+    // Input order is kept inside each group.
+    template<typename PairPtr>
+    void partition(node_type * n, size_type offset, PairPtr * first, PairPtr * last, PairPtr * scratch, size_type grain, std::vector<load_group<PairPtr> > & groups)
+    {
+        std::vector<size_type> bounds(charset_type::size + 2, 0);
+        for(PairPtr * it = first; it != last; ++it)
+        {
+            ++bounds[letter_at((*it)->first, offset) + 1];
+        }
+        for(size_type i = 1; i != bounds.size(); ++i)
+        {
+            bounds[i] += bounds[i - 1];
+        }
+        for(PairPtr * it = first; it != last; ++it)
+        {
+            scratch[bounds[letter_at((*it)->first, offset)]++] = *it;
+        }
+        std::copy(scratch, scratch + (last - first), first);
+
+        // bounds[i] is now the end of the group of letter i - 1, group 0 being the keys ending at offset
+        for(PairPtr * it = first; it != first + bounds[0]; ++it)
+        {
+            if(!n->get_value())
+            {
+                value_holder_ptr value = make_value((*it)->first, (*it)->second);
+                n->set_value(value);
+            }
+        }
+        for(size_type i = 1; i != bounds.size(); ++i)
+        {
+            PairPtr * gfirst = first + bounds[i - 1];
+            PairPtr * glast = first + bounds[i];
+            if(gfirst == glast)
+            {
+                continue;
+            }
+            if(size_type(glast - gfirst) <= grain)
+            {
+                groups.push_back(load_group<PairPtr>{n, i - 1, offset, gfirst, glast, nullptr, nullptr});
+                continue;
+            }
+            const key_type & key = (*gfirst)->first;
+            size_type end = key.size();
+            for(PairPtr * it = gfirst + 1; it != glast && end != offset + 1; ++it)
+            {
+                key_const_iterator pi = key.cbegin() + offset + 1;
+                key_const_iterator start = (*it)->first.cbegin() + offset + 1;
+                match_prefix(abc, pi, key.cbegin() + end, start, (*it)->first.cend());
+                end = std::distance(key.cbegin(), pi);
+            }
+            node_type * child = n->allocate_node(this->node_allocator, this->node_container_allocator, i - 1, prefixer_type::make_prefix(key, offset + 1, end - offset - 1));
+            partition(child, end, gfirst, glast, scratch, grain, groups);
+        }
+    }
+
+    // 0 when key ends at offset, its letter index + 1 otherwise
+    size_type letter_at(const key_type & key, size_type offset) const
+    {
+        return offset < key.size() ? (size_type)abc.to_int_type(key[offset]) + 1 : 0;
+    }
+
+    template<typename PairPtr>
+    void load_groups(std::vector<load_group<PairPtr> > & groups, size_type threads)
+    {
+        std::sort(groups.begin(), groups.end(), [](const load_group<PairPtr> & l, const load_group<PairPtr> & r)
+        {
+            return l.last - l.first > r.last - r.first;
+        });
+        try
+        {
+            for(load_group<PairPtr> & g : groups)
+            {
+                g.top = make_root();
+            }
+        }
+        catch(...)
+        {
+            release_groups(groups);
+            throw;
+        }
+
+        std::atomic<size_type> next(0);
+        auto work = [this, &groups, &next]()
+        {
+            for(size_type i = next++; i < groups.size(); i = next++)
+            {
+                load_group<PairPtr> & g = groups[i];
+                try
+                {
+                    load(g.top, g.offset, g.first, g.last, [](PairPtr * it) -> decltype(auto) { return **it; });
+                }
+                catch(...)
+                {
+                    g.error = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for(size_type i = 1; i < threads && i < groups.size(); ++i)
+        {
+            try
+            {
+                workers.emplace_back(work);
+            }
+            catch(const std::system_error &)
+            {
+                break;
+            }
+        }
+        work();
+        for(std::thread & worker : workers)
+        {
+            worker.join();
+        }
+
+        std::exception_ptr error;
+        try
+        {
+            for(load_group<PairPtr> & g : groups)
+            {
+                node_type * sub = g.top->get_next(g.index);
+                if(sub)
+                {
+                    g.node->attach_node(this->node_container_allocator, g.index, sub);
+                    g.top->release_node(this->node_container_allocator, g.index);
+                }
+                if(g.error && !error)
+                {
+                    error = g.error;
+                }
+            }
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        release_groups(groups);
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    template<typename PairPtr>
+    void release_groups(std::vector<load_group<PairPtr> > & groups) noexcept
+    {
+        for(load_group<PairPtr> & g : groups)
+        {
+            if(g.top)
+            {
+                node_type::destroy_root(g.top, this->node_container_allocator, this->node_allocator);
+                g.top = nullptr;
+            }
+        }
+    }
+
+    // node of k and whether its value was built from args. The walk down stops at the last node the path
+    // of k goes through, a hit returns it as is and a miss inserts the remaining letters below it.
+    template<typename... Args>
+    std::pair<node_type *, bool> emplace_value(const key_type & k, Args &&... args)
+    {
+        return emplace_value_below(root, 0, k, std::forward<Args>(args)...);
+    }
+
+    // as emplace_value, the walk starts from the deepest ancestor of the node of hint whose path k goes through
+    template<typename... Args>
+    std::pair<node_type *, bool> emplace_value(const const_iterator & hint, const key_type & k, Args &&... args)
+    {
+        node_type * node = const_cast<node_type *>(hint.get_node());
+        if(!node || !node->get_value())
+        {
+            return emplace_value_below(root, 0, k, std::forward<Args>(args)...);
+        }
+        size_type depth = path_length(node); // letters of the path down to the end of the prefix of node
+        size_type common = common_length(node, depth, k);
+        while(depth > common)
+        {
+            depth -= (size_type)std::distance(node->prefix_begin(), node->prefix_end()) + 1;
+            node = node->get_parent().first;
+        }
+        return emplace_value_below(node, depth, k, std::forward<Args>(args)...);
+    }
+
+    // letters of the path from the root to the end of the prefix of node
+    static size_type path_length(const node_type * node) noexcept
+    {
+        size_type length = 0;
+        for(; node->get_parent().first; node = node->get_parent().first)
+        {
+            length += (size_type)std::distance(node->prefix_begin(), node->prefix_end()) + 1;
+        }
+        return length;
+    }
+
+    // letters k shares with the path of node, which is depth letters long. The path is read from node up
+    // to the root so that keyless trees do not have to build the key.
+    size_type common_length(const node_type * node, size_type depth, const key_type & k) const
+    {
+        size_type common = std::min(depth, (size_type)k.size());
+        for(; node->get_parent().first; node = node->get_parent().first)
+        {
+            // the letter of the node in its parent then its prefix take the letters [start, depth)
+            size_type start = depth - (size_type)std::distance(node->prefix_begin(), node->prefix_end()) - 1;
+            if(start < common)
+            {
+                if(k[start] != abc.to_char_type(node->get_parent().second))
+                {
+                    common = start;
+                }
+                else
+                {
+                    auto mismatch = std::mismatch(node->prefix_begin(), node->prefix_begin() + (common - start - 1), k.begin() + start + 1);
+                    common = std::min(common, start + 1 + (size_type)std::distance(node->prefix_begin(), mismatch.first));
+                }
+            }
+            depth = start;
+        }
+        return common;
+    }
+
+    // emplace_value from node, whose path is the first depth letters of k
+    template<typename... Args>
+    std::pair<node_type *, bool> emplace_value_below(node_type * node, size_type depth, const key_type & k, Args &&... args)
+    {
+        key_const_iterator start = k.begin() + depth;
+        key_const_iterator last = k.end();
+        while(start != last)
+        {
+            node_type * child = node->get_next((size_type)abc.to_int_type(*start));
+            if(!child)
+            {
+                break;
+            }
+            key_const_iterator next = start;
+            ++next;
+            prefix_const_iterator pi = child->prefix_begin();
+            prefix_const_iterator pend = child->prefix_end();
+            match_prefix(abc, pi, pend, next, last);
+            if(pi != pend)
+            {
+                break;
+            }
+            node = child;
+            start = next;
+        }
+        if(start == last && node->get_value())
+        {
+            return std::make_pair(node, false);
+        }
+
+        unique_allocation a(this->allocator, 1);
+        storage_type::construct(a.get(), k, std::forward<Args>(args)...);
+        value_holder_ptr value(a.release(), value_holder_deleter_type(this->allocator));
+
+        const key_type & key = storage_type::stored_key(*value, k);
+        node = insert_node<node_type>(node, this->node_container_allocator, this->node_allocator, this->prefix_allocator, abc, key, key.begin() + std::distance(k.begin(), start), key.end());
+        node->set_value(value);
+        return std::make_pair(node, true);
+    }
+
+    // node of each key of [first, last) holding its value, nullptr for absent keys
+    template<class ForwardIterator>
+    std::vector<const node_type *> exact_nodes(ForwardIterator first, ForwardIterator last) const
+    {
+        std::vector<const node_type *> result(std::distance(first, last));
+        batch_getter<const node_type>::get_nodes(root, abc, first, last, [&result](size_type i, const std::pair<prefix_const_iterator, const node_type *> & p)
+        {
+            result[i] = exact_match(p);
+        });
+        return result;
+    }
+
+    // deepest node holding a value whose key is a prefix of key, nullptr when there is none
+    template<class Key>
+    const node_type * longest_prefix_node(const Key & key) const
+    {
+        const node_type * result = nullptr;
+        auto letters = key_range<letter_type, Key>::letters(key);
+        getter<const node_type>::visit_prefixes(root, abc, letters.first, letters.second, [&result](const node_type * node, size_type)
+        {
+            result = node;
+        });
+        return result;
+    }
+
+    // get_node from the root for the letters of key
+    template<class NodePtr, class Key>
+    std::pair<prefix_const_iterator, NodePtr> get_node(NodePtr node, const Key & key) const
+    {
+        auto letters = key_range<letter_type, Key>::letters(key);
+        return ::get_node<node_type>(node->prefix_begin(), node, abc, letters.first, letters.second);
+    }
+
     template<typename NodePtr>
     static NodePtr exact_match(const std::pair<prefix_const_iterator, NodePtr> & p)
     {
         return p.second && p.second->get_value() && p.first == p.second->prefix_end() ? p.second : nullptr;
     }
 
+    // 1 when A is allocator_type rebound, so that its objects share the memory of allocator_type
+    template<class A>
+    static constexpr long copy_of_allocator() noexcept
+    {
+        return std::is_same<A, typename std::allocator_traits<allocator_type>::template rebind_alloc<typename std::allocator_traits<A>::value_type> >::value ? 1 : 0;
+    }
+
     const charset_type abc;
     value_holder_allocator_type allocator;
     node_allocator_type node_allocator;
     prefix_allocator_type prefix_allocator;
     node_container_allocator_type node_container_allocator;
-    node_type root;
+    node_type * root;
+
+    // copies of allocator_type held by the members above, one term per allocator member. node_allocator
+    // is not one when nodes come from a pool.
+    static constexpr long allocator_copies = copy_of_allocator<value_holder_allocator_type>()
+                                             + copy_of_allocator<node_allocator_type>()
+                                             + copy_of_allocator<prefix_allocator_type>()
+                                             + copy_of_allocator<node_container_allocator_type>();
 };
 
 #endif //PREFIX_TREE_PREFIX_TREE_H
@@ -9,6 +9,9 @@
 #include <string>
 #include <string_view>
 
+#include "util/types.h"
+#include "util/inline_prefix.h"
+
 template<class K, class SubK, class MemoryManagement>
 class prefixer_traits
 {
@@ -39,6 +42,16 @@ public:
     {
         return prefix_type(key, start, length);
     }
+    // left + letter + right, used when a node is merged with its only sub node
+    static prefix_type concat(const prefix_type & left, CharT letter, const prefix_type & right)
+    {
+        prefix_type result;
+        result.reserve(left.length() + right.length() + 1);
+        result.append(left);
+        result.push_back(letter);
+        result.append(right);
+        return result;
+    }
     static size_type length(const prefix_type & prefix)
     {
         return prefix.length();
@@ -47,6 +60,43 @@ public:
 
 typedef basic_string_prefixer_traits<char> string_prefixer_traits;
 
+// prefixes of up to N letters kept inside the node, longer ones spilled to memory from Allocator
+template<class CharT, std::size_t N = 15, class Traits = std::char_traits<CharT>, class Allocator = std::allocator<CharT> >
+class basic_inline_prefixer_traits
+{
+public:
+    typedef std::basic_string<CharT, Traits, Allocator> key_type;
+    typedef inline_prefix<CharT, N, Allocator> prefix_type;
+    typedef own_memory prefix_life_cycle_traits;
+    typedef prefixer_traits<key_type, prefix_type, prefix_life_cycle_traits> type;
+
+    typedef typename prefix_type::size_type size_type;
+
+    static prefix_type make_prefix(const key_type & key, size_type start, size_type length)
+    {
+        return prefix_type(key.data() + start, length);
+    }
+    static prefix_type make_prefix(const prefix_type & prefix, size_type start, size_type length)
+    {
+        return prefix_type(prefix.data() + start, length);
+    }
+    static size_type length(const prefix_type & prefix)
+    {
+        return prefix.length();
+    }
+    static prefix_type concat(const prefix_type & left, CharT letter, const prefix_type & right)
+    {
+        key_type result;
+        result.reserve(left.length() + right.length() + 1);
+        result.append(left.begin(), left.end());
+        result.push_back(letter);
+        result.append(right.begin(), right.end());
+        return prefix_type(result.data(), result.length());
+    }
+};
+
+typedef basic_inline_prefixer_traits<char> inline_prefixer_traits;
+
 template<class CharT, class Traits = std::char_traits<CharT>, class Allocator = std::allocator<CharT> >
 class basic_string_view_prefixer_traits
 {
@@ -62,6 +112,10 @@ public:
     {
         return prefix_type(key.c_str()+start, length);
     }
+    static prefix_type make_prefix(const prefix_type & prefix, size_type start, size_type length)
+    {
+        return prefix.substr(start, length);
+    }
     static size_type length(const prefix_type & prefix)
     {
         return prefix.length();
@@ -0,0 +1,384 @@
+#ifndef PREFIX_TREE_SHARDED_PREFIX_TREE_H
+#define PREFIX_TREE_SHARDED_PREFIX_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "prefix_tree.h"
+
+// prefix_trees each holding a range of keys, with a reader writer lock per tree. A key goes to the shard
+// whose range holds the position of its first letters: with letters = 2, "ab" is at index(a) + 1, index(b) + 1
+// in base charset size + 1, a missing letter counting as 0. Positions follow key order, so shards are
+// visited in order for ordered and prefix walks. By default the position space is cut in equal ranges, a
+// sample of keys can be given to cut it at its quantiles instead.
+// Each shard has its own allocator, default constructed.
+template<class K, class T, class Charset, class Prefixer, class Allocator = std::allocator<T>, class Link = pointer_link, class Storage = keyed_value>
+class sharded_prefix_tree
+{
+public:
+    typedef std::size_t size_type;
+
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef Charset charset_type;
+    typedef prefix_tree<K, T, Charset, Prefixer, Allocator, Link, Storage> tree_type;
+    typedef sharded_prefix_tree<K, T, Charset, Prefixer, Allocator, Link, Storage> type;
+    typedef mapped_type value_type;
+
+    typedef typename key_type::const_iterator key_const_iterator;
+    typedef std::uint64_t position_type;
+
+    sharded_prefix_tree(size_type shards, const charset_type & abc = charset_type(), size_type letters = 1)
+    :abc(abc)
+    ,letters(letters)
+    {
+        check(shards, letters);
+        position_type space = position_space();
+        for(size_type i = 1; i < shards; ++i)
+        {
+            bounds.push_back((position_type)(space * i / shards));
+        }
+        make_shards(shards);
+    }
+
+    // shard ranges cut at the quantiles of the positions of the sample keys
+    template<class InputIterator>
+    sharded_prefix_tree(InputIterator sample_first, InputIterator sample_last, size_type shards, const charset_type & abc = charset_type(), size_type letters = 1)
+    :abc(abc)
+    ,letters(letters)
+    {
+        check(shards, letters);
+        std::vector<position_type> positions;
+        for(; sample_first != sample_last; ++sample_first)
+        {
+            positions.push_back(position(sample_first->begin(), sample_first->end(), false));
+        }
+        std::sort(positions.begin(), positions.end());
+        position_type space = position_space();
+        for(size_type i = 1; i < shards; ++i)
+        {
+            bounds.push_back(positions.empty() ? (position_type)(space * i / shards) : positions[positions.size() * i / shards]);
+        }
+        make_shards(shards);
+    }
+
+    sharded_prefix_tree(const sharded_prefix_tree &) = delete;
+    sharded_prefix_tree & operator=(const sharded_prefix_tree &) = delete;
+
+    // as prefix_tree::insert, false when key already has a value which is kept
+    bool insert(const key_type & key, const mapped_type & value)
+    {
+        shard & s = *shards[route(key)];
+        std::unique_lock<std::shared_mutex> lock(s.lock);
+        return s.tree.insert(key, value).second;
+    }
+
+    size_type erase(const key_type & key)
+    {
+        shard & s = *shards[route(key)];
+        std::unique_lock<std::shared_mutex> lock(s.lock);
+        return s.tree.erase(key);
+    }
+
+    size_type count(const key_type & key) const
+    {
+        const shard & s = *shards[route(key)];
+        std::shared_lock<std::shared_mutex> lock(s.lock);
+        return s.tree.count(key);
+    }
+
+    // copy of the value of key
+    mapped_type at(const key_type & key) const
+    {
+        const shard & s = *shards[route(key)];
+        std::shared_lock<std::shared_mutex> lock(s.lock);
+        return s.tree.at(key);
+    }
+
+    // call f with the value of key under the lock of its shard, false when key has no value
+    template<class F>
+    bool visit(const key_type & key, F f) const
+    {
+        const shard & s = *shards[route(key)];
+        std::shared_lock<std::shared_mutex> lock(s.lock);
+        typename tree_type::const_iterator it = s.tree.find(key);
+        if(it == s.tree.cend())
+        {
+            return false;
+        }
+        f(it.value());
+        return true;
+    }
+
+    // insert (key, value) pairs, each shard being locked once. Returns the number of keys inserted.
+    template<class ForwardIterator>
+    size_type insert_batch(ForwardIterator first, ForwardIterator last)
+    {
+        size_type result = 0;
+        by_shard(first, last, [](ForwardIterator it) -> const key_type & { return it->first; },
+        [&result](tree_type & tree, ForwardIterator it, size_type)
+        {
+            result += tree.insert(it->first, it->second).second ? 1 : 0;
+        });
+        return result;
+    }
+
+    // erase keys, each shard being locked once. Returns the number of keys erased.
+    template<class ForwardIterator>
+    size_type erase_batch(ForwardIterator first, ForwardIterator last)
+    {
+        size_type result = 0;
+        by_shard(first, last, [](ForwardIterator it) -> const key_type & { return *it; },
+        [&result](tree_type & tree, ForwardIterator it, size_type)
+        {
+            result += tree.erase(*it);
+        });
+        return result;
+    }
+
+    // write count(key) for each key to out in input order, each shard being locked once
+    template<class ForwardIterator, class OutputIterator>
+    OutputIterator count_batch(ForwardIterator first, ForwardIterator last, OutputIterator out) const
+    {
+        std::vector<size_type> counts(std::distance(first, last));
+        by_shard(first, last, [](ForwardIterator it) -> const key_type & { return *it; },
+        [&counts](const tree_type & tree, ForwardIterator it, size_type i)
+        {
+            counts[i] = tree.count(*it);
+        });
+        return std::copy(counts.begin(), counts.end(), out);
+    }
+
+    // call f(key, value) for every entry in key order, each shard being read locked while it is visited
+    template<class F>
+    void for_each(F f) const
+    {
+        for(const std::unique_ptr<shard> & s : shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(s->lock);
+            for(typename tree_type::const_iterator it = s->tree.cbegin(), last = s->tree.cend(); it != last; ++it)
+            {
+                f(it.key(), it.value());
+            }
+        }
+    }
+
+    // call f(key, value) for every entry whose key starts with prefix in key order, only the shards whose
+    // range can hold such keys are visited
+    template<class F>
+    void for_each_prefix(const key_type & prefix, F f) const
+    {
+        size_type first = route(position(prefix.begin(), prefix.end(), false));
+        size_type last = route(position(prefix.begin(), prefix.end(), true));
+        for(size_type i = first; i <= last; ++i)
+        {
+            const shard & s = *shards[i];
+            std::shared_lock<std::shared_mutex> lock(s.lock);
+            std::pair<typename tree_type::const_iterator, typename tree_type::const_iterator> range = s.tree.equal_prefix_range(prefix);
+            for(; range.first != range.second; ++range.first)
+            {
+                f(range.first.key(), range.first.value());
+            }
+        }
+    }
+
+    size_type size() const
+    {
+        size_type result = 0;
+        for(const std::unique_ptr<shard> & s : shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(s->lock);
+            result += s->tree.size();
+        }
+        return result;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    void clear()
+    {
+        for(const std::unique_ptr<shard> & s : shards)
+        {
+            std::unique_lock<std::shared_mutex> lock(s->lock);
+            s->tree.clear();
+        }
+    }
+
+    size_type shard_count() const noexcept
+    {
+        return shards.size();
+    }
+
+    // shard holding key
+    size_type route(const key_type & key) const
+    {
+        return route(position(key.begin(), key.end(), false));
+    }
+
+private:
+    struct alignas(64) shard
+    {
+        explicit shard(const charset_type & abc)
+        :tree(abc)
+        {
+        }
+
+        mutable std::shared_mutex lock;
+        tree_type tree;
+    };
+
+    static void check(size_type shards, size_type letters)
+    {
+        if(shards == 0)
+        {
+            throw std::invalid_argument("at least one shard is required");
+        }
+        position_type space = 1;
+        for(size_type i = 0; i != letters; ++i)
+        {
+            if(space > std::numeric_limits<position_type>::max() / (charset_type::size + 1))
+            {
+                throw std::invalid_argument("too many letters to route keys");
+            }
+            space *= charset_type::size + 1;
+        }
+    }
+
+    void make_shards(size_type count)
+    {
+        shards.reserve(count);
+        for(size_type i = 0; i != count; ++i)
+        {
+            shards.emplace_back(new shard(abc));
+        }
+    }
+
+    position_type position_space() const noexcept
+    {
+        position_type result = 1;
+        for(size_type i = 0; i != letters; ++i)
+        {
+            result *= charset_type::size + 1;
+        }
+        return result;
+    }
+
+    // position of the first letters of [start, last), missing letters count as 0, or as the last letter
+    // when highest is set to get the position of the last key starting with [start, last)
+    position_type position(key_const_iterator start, key_const_iterator last, bool highest) const
+    {
+        position_type result = 0;
+        for(size_type i = 0; i != letters; ++i)
+        {
+            result *= charset_type::size + 1;
+            if(start != last)
+            {
+                result += (position_type)abc.to_int_type(*start) + 1;
+                ++start;
+            }
+            else if(highest)
+            {
+                result += charset_type::size;
+            }
+        }
+        return result;
+    }
+
+    size_type route(position_type p) const
+    {
+        return (size_type)(std::upper_bound(bounds.begin(), bounds.end(), p) - bounds.begin());
+    }
+
+    // call op(tree, it, i) for the i-th element of [first, last) grouped by shard, each shard being write
+    // locked once
+    template<class ForwardIterator, class GetKey, class Op>
+    void by_shard(ForwardIterator first, ForwardIterator last, GetKey get_key, Op op)
+    {
+        shard_groups<ForwardIterator> groups(*this, first, last, get_key);
+        for(size_type s = 0; s != shards.size(); ++s)
+        {
+            if(groups.starts[s] != groups.starts[s + 1])
+            {
+                shard & current = *shards[s];
+                std::unique_lock<std::shared_mutex> lock(current.lock);
+                groups.apply(s, current.tree, op);
+            }
+        }
+    }
+
+    // as by_shard, each shard being read locked once
+    template<class ForwardIterator, class GetKey, class Op>
+    void by_shard(ForwardIterator first, ForwardIterator last, GetKey get_key, Op op) const
+    {
+        shard_groups<ForwardIterator> groups(*this, first, last, get_key);
+        for(size_type s = 0; s != shards.size(); ++s)
+        {
+            if(groups.starts[s] != groups.starts[s + 1])
+            {
+                const shard & current = *shards[s];
+                std::shared_lock<std::shared_mutex> lock(current.lock);
+                groups.apply(s, current.tree, op);
+            }
+        }
+    }
+
+    // elements of a batch sorted by shard, keeping their input order within a shard
+    template<class ForwardIterator>
+    struct shard_groups
+    {
+        template<class GetKey>
+        shard_groups(const sharded_prefix_tree & sharded, ForwardIterator first, ForwardIterator last, GetKey get_key)
+        :starts(sharded.shards.size() + 1, 0)
+        {
+            std::vector<size_type> routes;
+            for(ForwardIterator it = first; it != last; ++it)
+            {
+                items.push_back(it);
+                routes.push_back(sharded.route(get_key(it)));
+                ++starts[routes.back() + 1];
+            }
+            for(size_type i = 1; i != starts.size(); ++i)
+            {
+                starts[i] += starts[i - 1];
+            }
+            order.resize(items.size());
+            std::vector<size_type> next(starts.begin(), starts.end() - 1);
+            for(size_type i = 0; i != items.size(); ++i)
+            {
+                order[next[routes[i]]++] = i;
+            }
+        }
+
+        // op(tree, it, i) for the elements of shard s
+        template<class Tree, class Op>
+        void apply(size_type s, Tree & tree, Op & op) const
+        {
+            for(size_type j = starts[s]; j != starts[s + 1]; ++j)
+            {
+                op(tree, items[order[j]], order[j]);
+            }
+        }
+
+        std::vector<ForwardIterator> items;
+        std::vector<size_type> starts;      // first index in order of each shard, then the batch size
+        std::vector<size_type> order;       // indexes in items sorted by shard
+    };
+
+    const charset_type abc;
+    const size_type letters;
+    std::vector<position_type> bounds;      // first position of each shard but the first
+    std::vector<std::unique_ptr<shard> > shards;
+};
+
+#endif //PREFIX_TREE_SHARDED_PREFIX_TREE_H
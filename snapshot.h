@@ -0,0 +1,396 @@
+#ifndef PREFIX_TREE_SNAPSHOT_H
+#define PREFIX_TREE_SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Snapshot stream: a header then the entries in key order, each key stored as the length it
+// shares with the previous one and the remaining letters, followed by its value as written by a codec.
+// header: "PTSNAP" 0 0 | version | letter size | entry count       (integers as LEB128 varints)
+// entry:  shared length | suffix length | suffix letters | value
+// Those bytes are cut into blocks, each one preceded by its length, and an empty block ends the
+// snapshot. Readers never go past that end, so the stream may hold more data after the snapshot.
+
+inline std::size_t encode_varint(std::uint64_t value, char * bytes) noexcept
+{
+    std::size_t n = 0;
+    for(; value >= 0x80; value >>= 7)
+    {
+        bytes[n++] = (char)((value & 0x7f) | 0x80);
+    }
+    bytes[n++] = (char)value;
+    return n;
+}
+
+// Buffered writer, the stream is written by blocks of at most the buffer capacity.
+// finish must be called after the last entry.
+class snapshot_writer
+{
+public:
+    typedef std::size_t size_type;
+
+    explicit snapshot_writer(std::ostream & out, size_type capacity = 64 * 1024)
+    :out(out)
+    ,buffer(capacity)
+    ,used(0)
+    {
+    }
+
+    void write(const void * data, size_type n)
+    {
+        const char * p = static_cast<const char *>(data);
+        while(n)
+        {
+            if(used == buffer.size())
+            {
+                flush();
+            }
+            size_type chunk = std::min(n, buffer.size() - used);
+            std::memcpy(buffer.data() + used, p, chunk);
+            used += chunk;
+            p += chunk;
+            n -= chunk;
+        }
+    }
+
+    void write_varint(std::uint64_t value)
+    {
+        char bytes[10];
+        write(bytes, encode_varint(value, bytes));
+    }
+
+    // write the buffer as a block
+    void flush()
+    {
+        if(used)
+        {
+            char bytes[10];
+            out.write(bytes, (std::streamsize)encode_varint(used, bytes));
+            out.write(buffer.data(), (std::streamsize)used);
+            used = 0;
+        }
+        check();
+    }
+
+    // write the buffer and the empty block ending the snapshot
+    void finish()
+    {
+        flush();
+        out.put(0);
+        check();
+    }
+
+private:
+    void check() const
+    {
+        if(!out)
+        {
+            throw std::runtime_error("snapshot write failed");
+        }
+    }
+
+private:
+    std::ostream & out;
+    std::vector<char> buffer;
+    size_type used;
+};
+
+// Buffered reader, the stream is read by blocks of at most the buffer capacity and never past the
+// end of the snapshot. finish reads that end once the last entry has been read.
+class snapshot_reader
+{
+public:
+    typedef std::size_t size_type;
+
+    explicit snapshot_reader(std::istream & in, size_type capacity = 64 * 1024)
+    :in(in)
+    ,buffer(capacity)
+    ,position(0)
+    ,available(0)
+    ,block_left(0)
+    {
+    }
+
+    void read(void * data, size_type n)
+    {
+        char * p = static_cast<char *>(data);
+        while(n)
+        {
+            if(position == available)
+            {
+                fill();
+            }
+            size_type chunk = std::min(n, available - position);
+            std::memcpy(p, buffer.data() + position, chunk);
+            position += chunk;
+            p += chunk;
+            n -= chunk;
+        }
+    }
+
+    std::uint64_t read_varint()
+    {
+        std::uint64_t result = 0;
+        for(unsigned shift = 0; shift < 64; shift += 7)
+        {
+            unsigned char byte;
+            read(&byte, 1);
+            result |= std::uint64_t(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+            {
+                return result;
+            }
+        }
+        throw std::runtime_error("invalid snapshot: varint too long");
+    }
+
+    // read the empty block ending the snapshot, the stream is then left right after it
+    void finish()
+    {
+        if(position != available || block_left || next_block() != 0)
+        {
+            throw std::runtime_error("invalid snapshot: data after the last entry");
+        }
+    }
+
+private:
+    void fill()
+    {
+        if(!block_left)
+        {
+            block_left = next_block();
+            if(!block_left)
+            {
+                throw std::runtime_error("invalid snapshot: unexpected end of snapshot");
+            }
+        }
+        size_type n = (size_type)std::min<std::uint64_t>(block_left, buffer.size());
+        in.read(buffer.data(), (std::streamsize)n);
+        available = (size_type)in.gcount();
+        position = 0;
+        if(available != n)
+        {
+            throw std::runtime_error("invalid snapshot: unexpected end of stream");
+        }
+        block_left -= available;
+    }
+
+    // length of the next block, read byte by byte so that nothing after the snapshot is consumed
+    std::uint64_t next_block()
+    {
+        std::uint64_t result = 0;
+        for(unsigned shift = 0; shift < 64; shift += 7)
+        {
+            std::istream::int_type byte = in.get();
+            if(byte == std::istream::traits_type::eof())
+            {
+                throw std::runtime_error("invalid snapshot: unexpected end of stream");
+            }
+            result |= std::uint64_t(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+            {
+                return result;
+            }
+        }
+        throw std::runtime_error("invalid snapshot: varint too long");
+    }
+
+    std::istream & in;
+    std::vector<char> buffer;
+    size_type position;
+    size_type available;
+    std::uint64_t block_left;   // bytes of the current block not read into the buffer yet
+};
+
+// Codec of values whose bytes can be copied as is.
+// A codec has void encode(snapshot_writer &, const T &) and T decode(snapshot_reader &).
+template<typename T>
+struct trivial_codec
+{
+    static_assert(std::is_trivially_copyable<T>::value, "values are copied as bytes");
+
+    void encode(snapshot_writer & out, const T & value) const
+    {
+        out.write(&value, sizeof(T));
+    }
+
+    T decode(snapshot_reader & in) const
+    {
+        T value;
+        in.read(&value, sizeof(T));
+        return value;
+    }
+};
+
+struct snapshot_header
+{
+    static constexpr std::uint64_t current_version = 2;
+    static constexpr std::uint64_t max_key_length = std::uint64_t(1) << 24;   // letters
+
+    static const char * signature() noexcept
+    {
+        return "PTSNAP\0";
+    }
+};
+
+// Entries of a snapshot as (key, value) pairs, the pair is reused from one entry to the next.
+template<typename Key, typename Value, class Codec>
+class snapshot_input_iterator
+{
+public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef Codec codec_type;
+    typedef snapshot_input_iterator<key_type, mapped_type, codec_type> type;
+    typedef std::uint64_t size_type;
+    typedef typename key_type::value_type letter_type;
+
+    typedef std::input_iterator_tag iterator_category;
+    typedef std::pair<key_type, mapped_type> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type * pointer;
+    typedef const value_type & reference;
+
+    // end iterator
+    snapshot_input_iterator() noexcept
+    :in(nullptr)
+    ,codec(nullptr)
+    ,remaining(0)
+    {
+    }
+
+    snapshot_input_iterator(snapshot_reader & in, codec_type & codec, size_type count)
+    :in(&in)
+    ,codec(&codec)
+    ,remaining(count)
+    {
+        if(remaining)
+        {
+            read_entry();
+        }
+    }
+
+    reference operator*() const noexcept
+    {
+        return current;
+    }
+
+    pointer operator->() const noexcept
+    {
+        return &current;
+    }
+
+    type & operator++()
+    {
+        if(--remaining)
+        {
+            read_entry();
+        }
+        return *this;
+    }
+
+    bool operator==(const type & right) const noexcept
+    {
+        return remaining == right.remaining;
+    }
+
+    bool operator!=(const type & right) const noexcept
+    {
+        return remaining != right.remaining;
+    }
+
+private:
+    void read_entry()
+    {
+        size_type shared = in->read_varint();
+        size_type suffix = in->read_varint();
+        if(shared > current.first.size())
+        {
+            throw std::runtime_error("invalid snapshot: shared length longer than the previous key");
+        }
+        if(suffix > snapshot_header::max_key_length - shared)
+        {
+            throw std::runtime_error("invalid snapshot: key too long");
+        }
+        current.first.resize(shared + suffix);
+        if(suffix)
+        {
+            in->read(&current.first[shared], suffix * sizeof(letter_type));
+        }
+        current.second = codec->decode(*in);
+    }
+
+    snapshot_reader * in;
+    codec_type * codec;
+    size_type remaining;
+    value_type current;
+};
+
+// write the entries of tree to out
+template<class Tree, class Codec>
+void save_snapshot(const Tree & tree, std::ostream & out, Codec & codec)
+{
+    typedef typename Tree::key_type key_type;
+    typedef typename key_type::value_type letter_type;
+
+    snapshot_writer writer(out);
+    writer.write(snapshot_header::signature(), 8);
+    writer.write_varint(snapshot_header::current_version);
+    writer.write_varint(sizeof(letter_type));
+    writer.write_varint(tree.size());
+
+    key_type previous;
+    for(typename Tree::const_iterator it = tree.begin(), last = tree.end(); it != last; ++it)
+    {
+        const key_type & key = it.key();
+        if(key.size() > snapshot_header::max_key_length)
+        {
+            throw std::length_error("key too long for a snapshot");
+        }
+        std::size_t shared = std::mismatch(previous.begin(), previous.end(), key.begin(), key.end()).first - previous.begin();
+        writer.write_varint(shared);
+        writer.write_varint(key.size() - shared);
+        writer.write(key.data() + shared, (key.size() - shared) * sizeof(letter_type));
+        codec.encode(writer, it.value());
+        previous = key;
+    }
+    writer.finish();
+}
+
+// insert the entries read from in into tree, in a single pass when tree is empty (see bulk_load)
+template<class Tree, class Codec>
+void load_snapshot(Tree & tree, std::istream & in, Codec & codec)
+{
+    typedef typename Tree::key_type key_type;
+    typedef typename key_type::value_type letter_type;
+    typedef snapshot_input_iterator<key_type, typename Tree::mapped_type, Codec> iterator;
+
+    snapshot_reader reader(in);
+    char magic[8];
+    reader.read(magic, 8);
+    if(std::memcmp(magic, snapshot_header::signature(), 8) != 0)
+    {
+        throw std::runtime_error("invalid snapshot: bad signature");
+    }
+    if(reader.read_varint() != snapshot_header::current_version)
+    {
+        throw std::runtime_error("invalid snapshot: unsupported version");
+    }
+    if(reader.read_varint() != sizeof(letter_type))
+    {
+        throw std::runtime_error("invalid snapshot: letter size mismatch");
+    }
+    std::uint64_t count = reader.read_varint();
+    tree.bulk_load(iterator(reader, codec, count), iterator());
+    reader.finish();
+}
+
+#endif //PREFIX_TREE_SNAPSHOT_H
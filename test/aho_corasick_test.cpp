@@ -0,0 +1,93 @@
+// prefix_tree::scanner against looking up every substring of the text in std::map, for whole texts and
+// for texts scanned in chunks cut at random.
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    typedef std::tuple<std::size_t, std::size_t, int> match;
+
+    // occurrences by increasing end then decreasing length, as the scanner reports them
+    std::vector<match> brute_force(const std::map<std::string, int> & keys, const std::string & text, std::size_t max_length)
+    {
+        std::vector<match> result;
+        for(std::size_t end = 1; end <= text.size(); ++end)
+        {
+            for(std::size_t length = std::min(end, max_length); length; --length)
+            {
+                auto it = keys.find(text.substr(end - length, length));
+                if(it != keys.end())
+                {
+                    result.emplace_back(end - length, length, it->second);
+                }
+            }
+        }
+        return result;
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(10);
+        for(int round = 0; round != 30; ++round)
+        {
+            Tree tree;
+            std::map<std::string, int> keys;
+            tree.insert("", -1); // never matches
+            for(int i = 0, n = 1 + round * 10; i != n; ++i)
+            {
+                std::string key = random_key(random, "abc", 2 + round % 8);
+                if(!key.empty())
+                {
+                    tree.insert(key, i);
+                    keys.emplace(key, i);
+                }
+            }
+            auto scanner = tree.scanner();
+            CHECK(scanner.size() == keys.size());
+
+            std::string text = random_key(random, "abcx", 2000);
+            std::vector<match> expected = brute_force(keys, text, 10);
+
+            std::vector<match> found;
+            scanner.scan(text, [&found](std::size_t position, std::size_t length, int value)
+            {
+                found.emplace_back(position, length, value);
+            });
+            CHECK(found == expected);
+
+            // chunks of 0 to 20 letters, so some keys span several chunks
+            found.clear();
+            typename decltype(scanner)::cursor c;
+            for(std::size_t start = 0; start < text.size();)
+            {
+                std::size_t length = random() % 21;
+                scanner.scan(c, text.substr(start, length), [&found](std::size_t position, std::size_t length, int value)
+                {
+                    found.emplace_back(position, length, value);
+                });
+                start += length;
+            }
+            CHECK(c.offset == text.size());
+            CHECK(found == expected);
+        }
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "aho_corasick_test passed" << std::endl;
+    return 0;
+}
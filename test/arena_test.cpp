@@ -0,0 +1,160 @@
+// prefix_tree with arena_allocator against std::map, clear giving the arena memory back when the
+// tree owns it and when the arena is shared, and clear dropping objects without deallocating them one
+// by one when the tree owns the arena.
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    // arena_allocator counting the objects given back to the arena one by one
+    std::size_t arena_deallocations = 0;
+
+    template<typename T>
+    class counting_arena_allocator : public arena_allocator<T>
+    {
+    public:
+        template<typename U>
+        struct rebind
+        {
+            typedef counting_arena_allocator<U> other;
+        };
+
+        counting_arena_allocator() = default;
+
+        template<typename U>
+        counting_arena_allocator(const counting_arena_allocator<U> & allocator) noexcept
+        :arena_allocator<T>(allocator.get_arena())
+        {
+        }
+
+        void deallocate(T * p, std::size_t n) noexcept
+        {
+            if(n == 1 && arena::handles(sizeof(T), alignof(T)))
+            {
+                ++arena_deallocations;
+            }
+            arena_allocator<T>::deallocate(p, n);
+        }
+    };
+
+    template<class Tree>
+    void check_contents(const Tree & tree, const std::map<std::string, std::string> & expected)
+    {
+        CHECK(tree.size() == expected.size());
+        auto e = expected.begin();
+        for(auto it = tree.cbegin(); it != tree.cend(); ++it, ++e)
+        {
+            CHECK(e != expected.end());
+            CHECK(it.key() == e->first);
+            CHECK(it.value() == e->second);
+        }
+        CHECK(e == expected.end());
+    }
+
+    template<class Tree>
+    void fill(Tree & tree, std::map<std::string, std::string> & expected, std::mt19937 & random, int operations)
+    {
+        for(int i = 0; i != operations; ++i)
+        {
+            std::string key = random_key(random, "abcdxyz", 12);
+            if(random() % 4 == 0)
+            {
+                CHECK(tree.erase(key) == expected.erase(key));
+            }
+            else
+            {
+                // values long enough to live on the heap
+                std::string value = key + "-value-" + std::to_string(i) + std::string(24, 'v');
+                tree.insert_or_assign(key, value);
+                expected[key] = value;
+            }
+        }
+    }
+
+    template<class Tree>
+    void owned_arena()
+    {
+        std::mt19937 random(1);
+        Tree tree;
+        for(int round = 0; round != 3; ++round)
+        {
+            std::map<std::string, std::string> expected;
+            fill(tree, expected, random, 20000);
+            check_contents(tree, expected);
+            tree.clear();
+            CHECK(tree.empty());
+            CHECK(tree.get_allocator().get_arena()->size() == 0);
+            check_contents(tree, std::map<std::string, std::string>());
+        }
+    }
+
+    // an owned arena is reset by clear, a shared one gets each object back
+    template<class Tree>
+    void dropped_on_clear()
+    {
+        std::mt19937 random(3);
+        Tree tree;
+        std::map<std::string, std::string> expected;
+        fill(tree, expected, random, 5000);
+        std::size_t before = arena_deallocations;
+        tree.clear();
+        CHECK(arena_deallocations == before);
+        CHECK(tree.get_allocator().get_arena()->size() == 0);
+
+        typename Tree::allocator_type shared = tree.get_allocator();
+        expected.clear();
+        fill(tree, expected, random, 5000);
+        tree.clear();
+        CHECK(arena_deallocations != before);
+        CHECK(tree.get_allocator().get_arena()->size() == 0);
+    }
+
+    template<class Tree>
+    void shared_arena()
+    {
+        std::mt19937 random(2);
+        typename Tree::allocator_type allocator;
+        {
+            Tree first(ascii_charset(), allocator);
+            Tree second(ascii_charset(), allocator);
+            std::map<std::string, std::string> expected_first;
+            std::map<std::string, std::string> expected_second;
+            fill(first, expected_first, random, 20000);
+            fill(second, expected_second, random, 20000);
+
+            // the arena still holds the objects of the second tree
+            first.clear();
+            CHECK(allocator.get_arena()->size() != 0);
+            check_contents(second, expected_second);
+
+            second.clear();
+            CHECK(allocator.get_arena()->size() == 0);
+            CHECK(allocator.get_arena()->release());
+
+            expected_first.clear();
+            fill(first, expected_first, random, 5000);
+            check_contents(first, expected_first);
+        }
+        CHECK(allocator.get_arena()->size() == 0);
+    }
+}
+
+int main()
+{
+    for_each_tree_config<std::string, no_score, arena_allocator<std::string> >([](auto config)
+    {
+        owned_arena<typename decltype(config)::type>();
+        shared_arena<typename decltype(config)::type>();
+    });
+    for_each_tree_config<std::string, no_score, counting_arena_allocator<std::string> >([](auto config)
+    {
+        dropped_on_clear<typename decltype(config)::type>();
+    });
+    std::cout << "arena_test passed" << std::endl;
+    return 0;
+}
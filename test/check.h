@@ -0,0 +1,16 @@
+#ifndef PREFIX_TREE_TEST_CHECK_H
+#define PREFIX_TREE_TEST_CHECK_H
+
+#include <cstdlib>
+#include <iostream>
+
+// assert kept in release builds, the test stops at the first failed check
+#define CHECK(condition) ((condition) ? (void)0 : check_failed(#condition, __FILE__, __LINE__))
+
+[[noreturn]] inline void check_failed(const char * condition, const char * file, int line)
+{
+    std::cerr << file << ":" << line << ": check failed: " << condition << std::endl;
+    std::abort();
+}
+
+#endif //PREFIX_TREE_TEST_CHECK_H
@@ -0,0 +1,174 @@
+// concurrent_prefix_tree against std::map from one thread, then readers checking what they see while a
+// writer inserts and erases keys.
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../charset.h"
+#include "../concurrent_prefix_tree.h"
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    typedef concurrent_prefix_tree<std::string, int, ascii_charset> tree_type;
+
+    void check_contents(const tree_type & tree, const std::map<std::string, int> & expected)
+    {
+        CHECK(tree.size() == expected.size());
+        tree_type::reader r = tree.read();
+        auto e = expected.begin();
+        for(tree_type::const_iterator it = r.begin(); it != r.end(); ++it, ++e)
+        {
+            CHECK(e != expected.end());
+            CHECK(it.key() == e->first);
+            CHECK(*it == e->second);
+        }
+        CHECK(e == expected.end());
+    }
+
+    void check_lookups(const tree_type & tree, const std::map<std::string, int> & expected, const std::string & key)
+    {
+        tree_type::reader r = tree.read();
+        auto e = expected.find(key);
+        const int * value = r.get(key);
+        CHECK((value != nullptr) == (e != expected.end()));
+        CHECK(!value || *value == e->second);
+        CHECK((r.find(key) != r.end()) == (e != expected.end()));
+
+        auto lower = r.lower_bound(key);
+        auto expected_lower = expected.lower_bound(key);
+        CHECK((lower == r.end()) == (expected_lower == expected.end()));
+        CHECK(lower == r.end() || (lower.key() == expected_lower->first && *lower == expected_lower->second));
+
+        auto upper = r.upper_bound(key);
+        auto expected_upper = expected.upper_bound(key);
+        CHECK((upper == r.end()) == (expected_upper == expected.end()));
+        CHECK(upper == r.end() || upper.key() == expected_upper->first);
+
+        auto range = r.equal_prefix_range(key);
+        auto p = expected.lower_bound(key);
+        for(auto it = range.first; it != range.second; ++it, ++p)
+        {
+            CHECK(p != expected.end());
+            CHECK(it.key() == p->first);
+        }
+        CHECK(p == expected.end() || p->first.compare(0, key.size(), key) != 0);
+    }
+
+    void single_thread()
+    {
+        std::mt19937 random(1);
+        tree_type tree;
+        std::map<std::string, int> expected;
+        for(int i = 0; i != 100000; ++i)
+        {
+            std::string key = random_key(random, "abc", 7);
+            switch(random() % 4)
+            {
+            case 0:
+                CHECK(tree.insert(key, i) == expected.emplace(key, i).second);
+                break;
+            case 1:
+                CHECK(tree.insert_or_assign(key, i) == expected.insert_or_assign(key, i).second);
+                break;
+            case 2:
+                CHECK(tree.erase(key) == expected.erase(key));
+                break;
+            default:
+                check_lookups(tree, expected, key);
+                break;
+            }
+            CHECK(tree.size() == expected.size());
+            if(i % 1000 == 0)
+            {
+                check_contents(tree, expected);
+            }
+        }
+        check_contents(tree, expected);
+    }
+
+    // the writer only stores values v under the key of v, readers check each value they find against its
+    // key and that scans go by increasing keys
+    void readers_and_writer()
+    {
+        const int keys = 20000;
+        tree_type tree;
+        std::map<std::string, int> expected;
+        for(int k = 0; k < keys; k += 2)
+        {
+            tree.insert(std::to_string(k), k);
+            expected.emplace(std::to_string(k), k);
+        }
+
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> readers;
+        for(int r = 0; r != 3; ++r)
+        {
+            readers.emplace_back([&tree, &stop, r, keys]()
+            {
+                std::mt19937 random(r);
+                for(int n = 0; !stop.load(); ++n)
+                {
+                    tree_type::reader reader = tree.read();
+                    std::string key = std::to_string(random() % keys);
+                    const int * value = reader.get(key);
+                    CHECK(!value || std::to_string(*value) == key);
+                    if(n % 16 == 0)
+                    {
+                        std::string previous;
+                        int count = 0;
+                        for(auto it = reader.lower_bound(key); it != reader.end() && count != 64; ++it, ++count)
+                        {
+                            CHECK(std::to_string(*it) == it.key());
+                            CHECK(count == 0 || previous < it.key());
+                            previous = it.key();
+                        }
+                    }
+                    if(n % 64 == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        std::mt19937 random(9);
+        for(int i = 0; i != 200000; ++i)
+        {
+            int k = (int)(random() % keys);
+            std::string key = std::to_string(k);
+            if(random() % 2)
+            {
+                CHECK(tree.erase(key) == expected.erase(key));
+            }
+            else
+            {
+                tree.insert_or_assign(key, k);
+                expected[key] = k;
+            }
+            if(i % 256 == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        stop = true;
+        for(std::thread & t : readers)
+        {
+            t.join();
+        }
+        check_contents(tree, expected);
+    }
+}
+
+int main()
+{
+    single_thread();
+    readers_and_writer();
+    std::cout << "concurrent_test passed" << std::endl;
+    return 0;
+}
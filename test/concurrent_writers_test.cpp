@@ -0,0 +1,107 @@
+// Several writers updating a concurrent_prefix_tree at once, each one on its own keys checked against
+// its own std::map. The keys of the writers are interleaved so that they share prefixes and nodes.
+// Once they are done, the tree must hold the union of their maps.
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../charset.h"
+#include "../concurrent_prefix_tree.h"
+#include "check.h"
+
+namespace
+{
+    typedef concurrent_prefix_tree<std::string, int, ascii_charset> tree_type;
+
+    void run(int writers, int operations, int keys)
+    {
+        tree_type tree;
+        std::vector<std::map<std::string, int> > expected(writers);
+        std::atomic<bool> stop(false);
+
+        std::thread reader([&tree, &stop, keys]()
+        {
+            std::mt19937 random(100);
+            while(!stop.load())
+            {
+                tree_type::reader r = tree.read();
+                std::string key = std::to_string(random() % keys);
+                const int * value = r.get(key);
+                CHECK(!value || *value >= 0);
+                std::string previous;
+                int count = 0;
+                for(auto it = r.lower_bound(key); it != r.end() && count != 16; ++it, ++count)
+                {
+                    CHECK(count == 0 || previous < it.key());
+                    previous = it.key();
+                }
+                std::this_thread::yield();
+            }
+        });
+
+        std::vector<std::thread> threads;
+        for(int w = 0; w != writers; ++w)
+        {
+            threads.emplace_back([&tree, &expected, w, writers, operations, keys]()
+            {
+                std::mt19937 random(w);
+                std::map<std::string, int> & own = expected[w];
+                for(int i = 0; i != operations; ++i)
+                {
+                    std::string key = std::to_string((int)(random() % (keys / writers)) * writers + w);
+                    switch(random() % 3)
+                    {
+                    case 0:
+                        CHECK(tree.insert(key, i) == own.emplace(key, i).second);
+                        break;
+                    case 1:
+                        CHECK(tree.insert_or_assign(key, i) == own.insert_or_assign(key, i).second);
+                        break;
+                    default:
+                        CHECK(tree.erase(key) == own.erase(key));
+                        break;
+                    }
+                    if(random() % 8 == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for(std::thread & t : threads)
+        {
+            t.join();
+        }
+        stop = true;
+        reader.join();
+
+        std::map<std::string, int> all;
+        for(const std::map<std::string, int> & own : expected)
+        {
+            all.insert(own.begin(), own.end());
+        }
+        CHECK(tree.size() == all.size());
+        tree_type::reader r = tree.read();
+        auto e = all.begin();
+        for(tree_type::const_iterator it = r.begin(); it != r.end(); ++it, ++e)
+        {
+            CHECK(e != all.end());
+            CHECK(it.key() == e->first);
+            CHECK(*it == e->second);
+        }
+        CHECK(e == all.end());
+    }
+}
+
+int main()
+{
+    run(2, 50000, 2000);
+    run(4, 50000, 3000);
+    run(8, 20000, 400);
+    std::cout << "concurrent_writers_test passed" << std::endl;
+    return 0;
+}
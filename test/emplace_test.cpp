@@ -0,0 +1,183 @@
+// insert, try_emplace, emplace, insert_or_assign, operator[] and hinted insert against std::map, and
+// no allocation at all when the key is already present.
+
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    std::size_t allocations = 0;
+}
+
+void * operator new(std::size_t n)
+{
+    ++allocations;
+    void * p = std::malloc(n ? n : 1);
+    if(!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    // throws when built from a negative value
+    struct throwing
+    {
+        explicit throwing(int v)
+        :v(v)
+        {
+            if(v < 0)
+            {
+                throw std::invalid_argument("negative");
+            }
+        }
+
+        int v;
+    };
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(5);
+        Tree tree;
+        std::map<std::string, int> expected;
+        typename Tree::const_iterator hint = tree.cend();
+        for(int i = 0; i != 20000; ++i)
+        {
+            std::string key = random_key(random, "abcde", 8);
+            switch(random() % 6)
+            {
+            case 0:
+            {
+                auto r = tree.insert(key, i);
+                auto e = expected.emplace(key, i);
+                CHECK(r.second == e.second);
+                CHECK(r.first.value() == e.first->second);
+                break;
+            }
+            case 1:
+            {
+                auto r = tree.insert_or_assign(key, i);
+                CHECK(r.second == expected.insert_or_assign(key, i).second);
+                CHECK(r.first.value() == i);
+                break;
+            }
+            case 2:
+                tree[key] += 1;
+                expected[key] += 1;
+                break;
+            case 3:
+            {
+                auto r = tree.try_emplace(key, i);
+                CHECK(r.second == expected.try_emplace(key, i).second);
+                CHECK(r.first.key() == key);
+                break;
+            }
+            case 4:
+                hint = tree.insert(hint, key, i);
+                expected.emplace(key, i);
+                CHECK(hint.key() == key);
+                CHECK(hint.value() == expected[key]);
+                break;
+            default:
+                CHECK(tree.erase(key) == expected.erase(key));
+                hint = tree.cend();
+                break;
+            }
+        }
+
+        // keys past the small string buffer, whose copies would allocate
+        for(int i = 0; i != 500; ++i)
+        {
+            std::string key = std::string(16, "abcde"[i % 5]) + random_key(random, "abcde", 24);
+            tree.insert(key, i);
+            expected.emplace(key, i);
+        }
+
+        auto e = expected.begin();
+        for(auto it = tree.cbegin(); it != tree.cend(); ++it, ++e)
+        {
+            CHECK(e != expected.end());
+            CHECK(it.key() == e->first);
+            CHECK(it.value() == e->second);
+        }
+        CHECK(e == expected.end());
+
+        std::vector<std::string> keys;
+        for(const auto & entry : expected)
+        {
+            keys.push_back(entry.first);
+        }
+        std::size_t before = allocations;
+        hint = tree.cend();
+        for(const std::string & key : keys)
+        {
+            tree.insert(key, 1);
+            tree.try_emplace(key, 2);
+            tree.emplace(key, 3);
+            tree.insert_or_assign(key, 4);
+            tree[key] += 1;
+            hint = tree.insert(hint, key, 6);
+            int seven = 7;
+            hint = tree.insert(hint, key, std::move(seven));
+        }
+        CHECK(allocations == before);
+        for(const std::string & key : keys)
+        {
+            CHECK(tree.at(key) == 5);
+        }
+    }
+
+    template<class Tree>
+    void exception_safety()
+    {
+        Tree tree;
+        tree.try_emplace("abc", 1);
+        bool thrown = false;
+        try
+        {
+            tree.try_emplace("abd", -1);
+        }
+        catch(const std::invalid_argument &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(tree.size() == 1);
+        CHECK(tree.count("abc") && !tree.count("abd") && !tree.count("ab"));
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    for_each_tree_config<throwing>([](auto config)
+    {
+        exception_safety<typename decltype(config)::type>();
+    });
+    std::cout << "emplace_test passed" << std::endl;
+    return 0;
+}
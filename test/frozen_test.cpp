@@ -0,0 +1,150 @@
+// prefix_tree::freeze and frozen_prefix_tree against std::map: lookups, bounds, prefix ranges and
+// iteration of frozen random trees, then files which are truncated or written for other types.
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../frozen_prefix_tree.h"
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    typedef frozen_prefix_tree<std::string, int, ascii_charset> frozen_type;
+
+    const std::string path = "frozen_test.tree";
+
+    template<class Iterator, class MapIterator>
+    void check_same(const frozen_type & frozen, Iterator it, const std::map<std::string, int> & expected, MapIterator e)
+    {
+        CHECK((it == frozen.end()) == (e == expected.end()));
+        CHECK(it == frozen.end() || (it.key() == e->first && *it == e->second));
+    }
+
+    void check_lookups(const frozen_type & frozen, const std::map<std::string, int> & expected, const std::string & key)
+    {
+        check_same(frozen, frozen.find(key), expected, expected.find(key));
+        CHECK(frozen.count(key) == expected.count(key));
+        check_same(frozen, frozen.lower_bound(key), expected, expected.lower_bound(key));
+        check_same(frozen, frozen.upper_bound(key), expected, expected.upper_bound(key));
+
+        auto range = frozen.equal_prefix_range(key);
+        auto e = expected.lower_bound(key);
+        std::size_t count = 0;
+        for(auto it = range.first; it != range.second; ++it, ++e, ++count)
+        {
+            CHECK(e != expected.end());
+            CHECK(it.key() == e->first);
+            CHECK(*it == e->second);
+        }
+        CHECK(e == expected.end() || e->first.compare(0, key.size(), key) != 0);
+        CHECK(frozen.count_prefix(key) == count);
+    }
+
+    bool open_fails()
+    {
+        try
+        {
+            frozen_type frozen(path);
+        }
+        catch(const std::runtime_error &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(4);
+        for(int round = 0; round != 12; ++round)
+        {
+            Tree tree;
+            std::map<std::string, int> expected;
+            for(int i = 0, n = round * round * 50; i != n; ++i)
+            {
+                std::string key = random_key(random, "abcd", 10);
+                tree.insert(key, i);
+                expected.emplace(key, i);
+            }
+            tree.freeze(path);
+
+            frozen_type frozen(path);
+            CHECK(frozen.size() == expected.size());
+            CHECK(frozen.empty() == expected.empty());
+            auto e = expected.begin();
+            for(auto it = frozen.begin(); it != frozen.end(); ++it, ++e)
+            {
+                CHECK(e != expected.end());
+                CHECK(it.key() == e->first);
+                CHECK(*it == e->second);
+            }
+            CHECK(e == expected.end());
+
+            check_lookups(frozen, expected, "");
+            for(int i = 0; i != 1000; ++i)
+            {
+                check_lookups(frozen, expected, random_key(random, "abcde", 12));
+            }
+            for(const auto & entry : expected)
+            {
+                CHECK(frozen.at(entry.first) == entry.second);
+                check_lookups(frozen, expected, entry.first + "a");
+            }
+        }
+        std::remove(path.c_str());
+    }
+
+    // a file cut short, or frozen from a tree of other values, is refused
+    void bad_files()
+    {
+        std::mt19937 random(8);
+        prefix_tree<std::string, int, ascii_charset, string_prefixer_traits> tree;
+        for(int i = 0; i != 1000; ++i)
+        {
+            tree.insert(random_key(random, "abcd", 10), i);
+        }
+        tree.freeze(path);
+        long size = (long)mapped_file::open(path).size();
+        std::vector<long> cuts = {0, (long)sizeof(frozen_header) - 1, (long)sizeof(frozen_header), size - 1};
+        for(int i = 0; i != 20; ++i)
+        {
+            cuts.push_back((long)(random() % size));
+        }
+        for(long cut : cuts)
+        {
+            tree.freeze(path);
+            CHECK(::truncate(path.c_str(), (off_t)cut) == 0);
+            CHECK(open_fails());
+        }
+
+        prefix_tree<std::string, double, ascii_charset, string_prefixer_traits> doubles;
+        doubles.insert("a", 1.0);
+        doubles.freeze(path);
+        CHECK(open_fails());
+
+        prefix_tree<std::string, char, ascii_charset, string_prefixer_traits> chars;
+        chars.insert("a", 'a');
+        chars.freeze(path);
+        CHECK(open_fails());
+        std::remove(path.c_str());
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    bad_files();
+    std::cout << "frozen_test passed" << std::endl;
+    return 0;
+}
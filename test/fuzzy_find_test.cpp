@@ -0,0 +1,93 @@
+// fuzzy_find against a brute force Levenshtein distance over every key.
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    std::size_t levenshtein(const std::string & a, const std::string & b)
+    {
+        std::vector<std::size_t> previous(b.size() + 1);
+        std::vector<std::size_t> current(b.size() + 1);
+        for(std::size_t j = 0; j <= b.size(); ++j)
+        {
+            previous[j] = j;
+        }
+        for(std::size_t i = 1; i <= a.size(); ++i)
+        {
+            current[0] = i;
+            for(std::size_t j = 1; j <= b.size(); ++j)
+            {
+                current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (a[i - 1] != b[j - 1] ? 1 : 0)});
+            }
+            std::swap(previous, current);
+        }
+        return previous[b.size()];
+    }
+
+    template<class Tree>
+    void run()
+    {
+        typedef std::tuple<std::string, int, std::size_t> match_type;
+        std::mt19937 random(5);
+        Tree tree;
+        std::map<std::string, int> entries;
+        for(int i = 0; i != 2000; ++i)
+        {
+            std::string key = random_key(random, "abcd", 9);
+            tree.insert(key, i);
+            entries.emplace(key, i);
+        }
+        for(int round = 0; round != 200; ++round)
+        {
+            std::string query = random_key(random, "abcd", 10);
+            std::size_t distance = random() % 4;
+
+            // std::map order is the tree order for these letters
+            std::vector<match_type> expected;
+            for(const auto & entry : entries)
+            {
+                std::size_t d = levenshtein(entry.first, query);
+                if(d <= distance)
+                {
+                    expected.emplace_back(entry.first, entry.second, d);
+                }
+            }
+            std::vector<match_type> found;
+            std::size_t count = tree.fuzzy_find(query, distance, [&found](const std::string & key, const int & value, std::size_t d)
+            {
+                found.emplace_back(key, value, d);
+            });
+            CHECK(count == found.size());
+            CHECK(found == expected);
+
+            // the limit keeps the first matches in key order
+            std::size_t limit = random() % 4;
+            std::vector<match_type> limited;
+            count = tree.fuzzy_find(std::string_view(query), distance, [&limited](const std::string & key, const int & value, std::size_t d)
+            {
+                limited.emplace_back(key, value, d);
+            }, limit);
+            CHECK(count == std::min(limit, expected.size()));
+            CHECK(std::equal(limited.begin(), limited.end(), expected.begin()));
+        }
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "fuzzy_find_test passed" << std::endl;
+    return 0;
+}
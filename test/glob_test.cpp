@@ -0,0 +1,81 @@
+// match against POSIX fnmatch over every key, on random patterns built from literals, wildcards,
+// classes and escapes.
+
+#include <fnmatch.h>
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    template<class Tree>
+    void run()
+    {
+        typedef std::pair<std::string, int> entry_type;
+        static const char * const tokens[] = {"a", "b", "c", "/", "*", "?", "[ab]", "[!a]", "[a-b]", "[^/]", "\\*", "\\?", "**"};
+        std::mt19937 random(11);
+        Tree tree;
+        std::map<std::string, int> entries;
+        for(int i = 0; i != 3000; ++i)
+        {
+            std::string key = random_key(random, "abc/*?", 9);
+            tree.insert(key, i);
+            entries.emplace(key, i);
+        }
+        for(int round = 0; round != 2000; ++round)
+        {
+            std::string pattern;
+            for(std::size_t n = random() % 6; n; --n)
+            {
+                pattern += tokens[random() % (sizeof(tokens) / sizeof(tokens[0]))];
+            }
+            std::vector<entry_type> expected;
+            for(const auto & entry : entries)
+            {
+                if(fnmatch(pattern.c_str(), entry.first.c_str(), 0) == 0)
+                {
+                    expected.push_back(entry);
+                }
+            }
+            std::vector<entry_type> found;
+            std::size_t count = tree.match(pattern, [&found](const std::string & key, const int & value)
+            {
+                found.emplace_back(key, value);
+            });
+            CHECK(count == found.size());
+            if(found != expected)
+            {
+                std::cerr << "pattern " << pattern << std::endl;
+            }
+            CHECK(found == expected);
+        }
+
+        bool thrown = false;
+        try
+        {
+            tree.match("a[bc", [](const std::string &, const int &) {});
+        }
+        catch(const std::invalid_argument &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "glob_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Lookups taking string views, C strings, letter arrays and other letter ranges must give the same
+// results as with key_type, without building a key.
+
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    std::size_t allocations = 0;
+}
+
+void * operator new(std::size_t n)
+{
+    ++allocations;
+    void * p = std::malloc(n ? n : 1);
+    if(!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(5);
+        Tree tree;
+        const Tree & const_tree = tree;
+        for(int i = 0; i != 3000; ++i)
+        {
+            tree.insert(random_key(random, "abcde", 8), i);
+        }
+        std::vector<std::string> queries;
+        for(int i = 0; i != 2000; ++i)
+        {
+            queries.push_back(random_key(random, "abcde", 8));
+        }
+
+        std::size_t before = allocations;
+        for(const std::string & key : queries)
+        {
+            std::string_view view(key);
+            const char * c_string = key.c_str();
+            CHECK(tree.count(view) == tree.count(key));
+            CHECK(tree.count(c_string) == tree.count(key));
+            CHECK(tree.find(view) == tree.find(key));
+            CHECK(const_tree.find(c_string) == const_tree.find(key));
+            CHECK(tree.count_prefix(view) == tree.count_prefix(key));
+            CHECK(tree.rank(view) == tree.rank(key));
+            CHECK(const_tree.lower_bound(view) == const_tree.lower_bound(key));
+            CHECK(tree.upper_bound(c_string) == tree.upper_bound(key));
+            CHECK(const_tree.equal_prefix_range(view) == const_tree.equal_prefix_range(key));
+            CHECK(!tree.count(key) || &tree.at(view) == &tree.at(key));
+        }
+        // keyless iterators build their key
+        CHECK(Tree::iterator::keyless || allocations == before);
+
+        std::vector<std::size_t> counts;
+        tree.count_batch(queries.begin(), queries.end(), std::back_inserter(counts));
+        std::vector<std::string_view> views(queries.begin(), queries.end());
+        std::vector<const char *> c_strings;
+        std::vector<std::vector<char> > arrays;
+        for(const std::string & key : queries)
+        {
+            c_strings.push_back(key.c_str());
+            arrays.emplace_back(key.begin(), key.end());
+        }
+        std::vector<std::size_t> view_counts;
+        std::vector<std::size_t> c_string_counts;
+        std::vector<std::size_t> array_counts;
+        tree.count_batch(views.begin(), views.end(), std::back_inserter(view_counts));
+        tree.count_batch(c_strings.begin(), c_strings.end(), std::back_inserter(c_string_counts));
+        tree.count_batch(arrays.begin(), arrays.end(), std::back_inserter(array_counts));
+        CHECK(view_counts == counts);
+        CHECK(c_string_counts == counts);
+        CHECK(array_counts == counts);
+        std::vector<typename Tree::const_iterator> found;
+        std::vector<typename Tree::const_iterator> found_views;
+        const_tree.find_batch(queries.begin(), queries.end(), std::back_inserter(found));
+        const_tree.find_batch(views.begin(), views.end(), std::back_inserter(found_views));
+        CHECK(found == found_views);
+        for(std::size_t i = 0; i != queries.size(); ++i)
+        {
+            CHECK(counts[i] == tree.count(queries[i]));
+            CHECK(found[i] == const_tree.find(queries[i]));
+        }
+
+        std::list<char> letters(queries[0].begin(), queries[0].end());
+        CHECK(tree.count(letters) == tree.count(queries[0]));
+        CHECK(tree.count("") == tree.count(std::string()));
+        char array[] = "abc";
+        CHECK(tree.count(array) == tree.count(std::string("abc")));
+
+        for(const std::string & key : queries)
+        {
+            std::size_t count = tree.count(key);
+            CHECK(tree.erase(std::string_view(key)) == count);
+            CHECK(!tree.count(key));
+        }
+        bool thrown = false;
+        try
+        {
+            tree.at("zzzzz");
+        }
+        catch(const std::out_of_range &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+int main()
+{
+    static_assert(!key_range<char, int>::value && !key_range<char, std::vector<int> >::value, "not letter ranges");
+    static_assert(key_range<char, std::vector<char> >::value && key_range<char, const char *>::value, "letter ranges");
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "key_range_test passed" << std::endl;
+    return 0;
+}
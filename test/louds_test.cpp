@@ -0,0 +1,151 @@
+// bit_vector rank and select against a naive count around the 512 bits blocks of its index, then
+// prefix_tree::succinct against std::map: lookups, prefix ranges and iteration.
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../util/bit_vector.h"
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    // every rank and select of bits drawn with a one in every period bits on average
+    void check_bit_vector(std::mt19937 & random, std::size_t size, unsigned period)
+    {
+        std::vector<bool> bits;
+        bit_vector vector;
+        for(std::size_t i = 0; i != size; ++i)
+        {
+            bits.push_back(period != 0 && random() % period == 0);
+            vector.push_back(bits.back());
+        }
+        vector.build_index();
+        CHECK(vector.size() == size);
+
+        std::vector<std::size_t> ones;
+        std::vector<std::size_t> zeros;
+        for(std::size_t i = 0; i <= size; ++i)
+        {
+            CHECK(vector.rank1(i) == ones.size());
+            CHECK(vector.rank0(i) == zeros.size());
+            if(i != size)
+            {
+                CHECK(vector[i] == bits[i]);
+                (bits[i] ? ones : zeros).push_back(i);
+            }
+        }
+        CHECK(vector.count1() == ones.size());
+        for(std::size_t j = 0; j != ones.size(); ++j)
+        {
+            CHECK(vector.select1(j) == ones[j]);
+        }
+        for(std::size_t j = 0; j != zeros.size(); ++j)
+        {
+            CHECK(vector.select0(j) == zeros[j]);
+        }
+    }
+
+    void bit_vectors()
+    {
+        std::mt19937 random(2);
+        for(std::size_t blocks : {0, 1, 2, 3, 8})
+        {
+            for(int shift : {-65, -64, -63, -1, 0, 1, 63, 64, 65})
+            {
+                long size = (long)(blocks * bit_vector::block_bits) + shift;
+                if(size < 0)
+                {
+                    continue;
+                }
+                for(unsigned period : {0u, 1u, 2u, 3u, 64u, 700u})
+                {
+                    check_bit_vector(random, (std::size_t)size, period);
+                }
+            }
+        }
+    }
+
+    template<class Succinct>
+    void check_lookups(const Succinct & succinct, const std::map<std::string, int> & expected, const std::string & key)
+    {
+        auto e = expected.find(key);
+        auto it = succinct.find(key);
+        CHECK((it == succinct.end()) == (e == expected.end()));
+        CHECK(it == succinct.end() || (it.key() == key && *it == e->second));
+        CHECK(succinct.count(key) == expected.count(key));
+
+        auto range = succinct.equal_prefix_range(key);
+        auto p = expected.lower_bound(key);
+        for(; range.first != range.second; ++range.first, ++p)
+        {
+            CHECK(p != expected.end());
+            CHECK(range.first.key() == p->first);
+            CHECK(range.first.value() == p->second);
+        }
+        CHECK(p == expected.end() || p->first.compare(0, key.size(), key) != 0);
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(6);
+        for(int round = 0; round != 12; ++round)
+        {
+            Tree tree;
+            std::map<std::string, int> expected;
+            for(int i = 0, n = round * round * 50; i != n; ++i)
+            {
+                std::string key = random_key(random, "abcd", 10);
+                tree.insert(key, i);
+                expected.emplace(key, i);
+            }
+            auto succinct = tree.succinct();
+            CHECK(succinct.size() == expected.size());
+            CHECK(succinct.empty() == expected.empty());
+            auto e = expected.begin();
+            for(auto it = succinct.begin(); it != succinct.end(); ++it, ++e)
+            {
+                CHECK(e != expected.end());
+                CHECK(it.key() == e->first);
+                CHECK(*it == e->second);
+            }
+            CHECK(e == expected.end());
+
+            check_lookups(succinct, expected, "");
+            for(int i = 0; i != 1000; ++i)
+            {
+                check_lookups(succinct, expected, random_key(random, "abcde", 12));
+            }
+            for(const auto & entry : expected)
+            {
+                CHECK(succinct.at(entry.first) == entry.second);
+                check_lookups(succinct, expected, entry.first + "a");
+            }
+            bool thrown = false;
+            try
+            {
+                succinct.at("e");
+            }
+            catch(const std::out_of_range &)
+            {
+                thrown = true;
+            }
+            CHECK(thrown);
+        }
+    }
+}
+
+int main()
+{
+    bit_vectors();
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "louds_test passed" << std::endl;
+    return 0;
+}
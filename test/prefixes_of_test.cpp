@@ -0,0 +1,90 @@
+// longest_prefix_match and all_prefixes_of against probing count(key.substr(0, l)) for every length l,
+// for the empty key, random keys and keys running past a leaf.
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    template<class Tree>
+    void check_prefixes(Tree & tree, const std::string & key)
+    {
+        const Tree & const_tree = tree;
+        std::vector<std::pair<std::size_t, int> > expected;
+        for(std::size_t l = 0; l <= key.size(); ++l)
+        {
+            if(const_tree.count(key.substr(0, l)))
+            {
+                expected.emplace_back(l, const_tree.at(key.substr(0, l)));
+            }
+        }
+
+        std::vector<std::pair<std::size_t, int> > found;
+        const_tree.all_prefixes_of(key, [&found](std::size_t length, const int & value)
+        {
+            found.emplace_back(length, value);
+        });
+        CHECK(found == expected);
+        found.clear();
+        tree.all_prefixes_of(key, [&found](std::size_t length, int & value)
+        {
+            found.emplace_back(length, value);
+        });
+        CHECK(found == expected);
+
+        auto longest = const_tree.longest_prefix_match(key);
+        CHECK((longest == const_tree.cend()) == expected.empty());
+        CHECK(expected.empty() || (longest.key() == key.substr(0, expected.back().first) && longest.value() == expected.back().second));
+        auto mutable_longest = tree.longest_prefix_match(key);
+        CHECK(expected.empty() ? mutable_longest == tree.end() : mutable_longest == tree.find(key.substr(0, expected.back().first)));
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(12);
+        for(int round = 0; round != 20; ++round)
+        {
+            Tree tree;
+            std::map<std::string, int> keys;
+            if(round % 2)
+            {
+                tree.insert("", -1);
+                keys.emplace("", -1);
+            }
+            for(int i = 0, n = round * 40; i != n; ++i)
+            {
+                std::string key = random_key(random, "abc", 8);
+                tree.insert(key, i);
+                keys.emplace(key, i);
+            }
+
+            check_prefixes(tree, "");
+            for(int i = 0; i != 500; ++i)
+            {
+                check_prefixes(tree, random_key(random, "abcd", 12));
+            }
+            for(const auto & entry : keys)
+            {
+                check_prefixes(tree, entry.first);
+                check_prefixes(tree, entry.first + random_key(random, "abcd", 6));
+            }
+        }
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "prefixes_of_test passed" << std::endl;
+    return 0;
+}
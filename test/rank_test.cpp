@@ -0,0 +1,102 @@
+// rank, select and count_prefix against std::map, on trees built by insert, after erases and after
+// parallel_load.
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    template<class Tree>
+    void check_ranks(Tree & tree, const std::map<std::string, int> & expected, std::mt19937 & random)
+    {
+        const Tree & const_tree = tree;
+        CHECK(tree.size() == expected.size());
+        std::size_t i = 0;
+        for(auto e = expected.begin(); e != expected.end(); ++e, ++i)
+        {
+            auto it = const_tree.select(i);
+            CHECK(it != const_tree.cend());
+            CHECK(it.key() == e->first);
+            CHECK(it.value() == e->second);
+            CHECK(tree.select(i) == tree.find(e->first));
+            CHECK(tree.rank(e->first) == i);
+        }
+        CHECK(const_tree.select(expected.size()) == const_tree.cend());
+        CHECK(tree.select(expected.size()) == tree.end());
+        CHECK(const_tree.select(expected.size() + 10) == const_tree.cend());
+
+        std::vector<std::string> probes(1, "");
+        for(int n = 0; n != 300; ++n)
+        {
+            probes.push_back(random_key(random, "abcde", 10));
+        }
+        for(const auto & entry : expected)
+        {
+            if(random() % 8 == 0)
+            {
+                probes.push_back(entry.first + "a");
+                probes.push_back(entry.first.substr(0, entry.first.size() / 2));
+            }
+        }
+        for(const std::string & key : probes)
+        {
+            CHECK(tree.rank(key) == (std::size_t)std::distance(expected.begin(), expected.lower_bound(key)));
+            std::size_t with_prefix = (std::size_t)std::count_if(expected.begin(), expected.end(), [&key](const std::pair<const std::string, int> & entry)
+            {
+                return entry.first.compare(0, key.size(), key) == 0;
+            });
+            CHECK(tree.count_prefix(key) == with_prefix);
+        }
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(13);
+        for(int round = 0; round != 8; ++round)
+        {
+            Tree tree;
+            std::map<std::string, int> expected;
+            std::vector<std::pair<std::string, int> > pairs;
+            for(int i = 0, n = round * round * 40; i != n; ++i)
+            {
+                std::string key = random_key(random, "abcd", 10);
+                tree.insert(key, i);
+                expected.emplace(key, i);
+                pairs.emplace_back(key, i);
+            }
+            check_ranks(tree, expected, random);
+
+            Tree loaded;
+            loaded.parallel_load(pairs.begin(), pairs.end(), 4);
+            check_ranks(loaded, expected, random);
+
+            for(const std::pair<std::string, int> & entry : pairs)
+            {
+                if(random() % 2)
+                {
+                    CHECK(tree.erase(entry.first) == expected.erase(entry.first));
+                }
+            }
+            check_ranks(tree, expected, random);
+        }
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "rank_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,168 @@
+// sharded_prefix_tree against std::map, with shards cut in equal ranges and at the quantiles of a sample:
+// threads inserting and erasing their own keys, then batches, ordered walks and prefix walks.
+
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../charset.h"
+#include "../sharded_prefix_tree.h"
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    typedef sharded_prefix_tree<std::string, int, ascii_charset, string_prefixer_traits> tree_type;
+
+    const std::string letters = "abcdz";
+
+    void check_contents(const tree_type & tree, const std::map<std::string, int> & expected)
+    {
+        CHECK(tree.size() == expected.size());
+        auto e = expected.begin();
+        tree.for_each([&e, &expected](const std::string & key, int value)
+        {
+            CHECK(e != expected.end());
+            CHECK(key == e->first);
+            CHECK(value == e->second);
+            ++e;
+        });
+        CHECK(e == expected.end());
+    }
+
+    void check_prefix(const tree_type & tree, const std::map<std::string, int> & expected, const std::string & prefix)
+    {
+        auto e = expected.lower_bound(prefix);
+        tree.for_each_prefix(prefix, [&e, &expected](const std::string & key, int value)
+        {
+            CHECK(e != expected.end());
+            CHECK(key == e->first);
+            CHECK(value == e->second);
+            ++e;
+        });
+        CHECK(e == expected.end() || e->first.compare(0, prefix.size(), prefix) != 0);
+    }
+
+    // each thread inserts and erases the keys whose last letter it owns, so that the final contents are
+    // the union of the maps of the threads
+    void threads(tree_type & tree, std::map<std::string, int> & expected)
+    {
+        const int thread_count = 4;
+        std::vector<std::map<std::string, int> > owned(thread_count);
+        std::vector<std::thread> workers;
+        for(int t = 0; t != thread_count; ++t)
+        {
+            workers.emplace_back([&tree, &owned, t]()
+            {
+                std::mt19937 random(t);
+                std::map<std::string, int> & mine = owned[t];
+                for(int i = 0; i != 20000; ++i)
+                {
+                    std::string key = random_key(random, letters, 7) + (char)('a' + t);
+                    if(random() % 3 == 0)
+                    {
+                        CHECK(tree.erase(key) == mine.erase(key));
+                    }
+                    else
+                    {
+                        CHECK(tree.insert(key, i) == mine.emplace(key, i).second);
+                    }
+                    CHECK(tree.count(key) == mine.count(key));
+                }
+            });
+        }
+        for(std::thread & w : workers)
+        {
+            w.join();
+        }
+        for(const std::map<std::string, int> & mine : owned)
+        {
+            expected.insert(mine.begin(), mine.end());
+        }
+        check_contents(tree, expected);
+    }
+
+    void batches(tree_type & tree, std::map<std::string, int> & expected)
+    {
+        std::mt19937 random(7);
+        for(int round = 0; round != 20; ++round)
+        {
+            std::vector<std::pair<std::string, int> > entries;
+            std::size_t inserted = 0;
+            for(int i = 0; i != 500; ++i)
+            {
+                entries.emplace_back(random_key(random, letters, 6), round * 1000 + i);
+                inserted += expected.emplace(entries.back()).second ? 1 : 0;
+            }
+            CHECK(tree.insert_batch(entries.begin(), entries.end()) == inserted);
+
+            std::vector<std::string> keys;
+            std::size_t erased = 0;
+            for(int i = 0; i != 200; ++i)
+            {
+                keys.push_back(random_key(random, letters, 6));
+                erased += expected.erase(keys.back());
+            }
+            CHECK(tree.erase_batch(keys.begin(), keys.end()) == erased);
+
+            keys.clear();
+            for(int i = 0; i != 300; ++i)
+            {
+                keys.push_back(random_key(random, letters, 6));
+            }
+            std::vector<std::size_t> counts;
+            tree.count_batch(keys.begin(), keys.end(), std::back_inserter(counts));
+            CHECK(counts.size() == keys.size());
+            for(std::size_t i = 0; i != keys.size(); ++i)
+            {
+                CHECK(counts[i] == expected.count(keys[i]));
+            }
+            check_contents(tree, expected);
+        }
+    }
+
+    void run(tree_type & tree)
+    {
+        std::map<std::string, int> expected;
+        threads(tree, expected);
+        batches(tree, expected);
+
+        std::mt19937 random(3);
+        check_prefix(tree, expected, "");
+        for(int i = 0; i != 500; ++i)
+        {
+            check_prefix(tree, expected, random_key(random, letters, 5));
+        }
+        for(const auto & entry : expected)
+        {
+            CHECK(tree.at(entry.first) == entry.second);
+        }
+
+        tree.clear();
+        CHECK(tree.empty());
+        check_prefix(tree, std::map<std::string, int>(), "a");
+    }
+}
+
+int main()
+{
+    tree_type equal(5, ascii_charset(), 2);
+    run(equal);
+
+    std::mt19937 random(11);
+    std::vector<std::string> sample;
+    for(int i = 0; i != 1000; ++i)
+    {
+        sample.push_back(random_key(random, letters, 7));
+    }
+    tree_type quantiles(sample.begin(), sample.end(), 7, ascii_charset(), 2);
+    CHECK(quantiles.shard_count() == 7);
+    run(quantiles);
+
+    std::cout << "sharded_test passed" << std::endl;
+    return 0;
+}
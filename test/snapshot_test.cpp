@@ -0,0 +1,133 @@
+// save and load against std::map: round trips, snapshots followed by other data in the same stream
+// and corrupt streams.
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    struct string_codec
+    {
+        void encode(snapshot_writer & out, const std::string & value) const
+        {
+            out.write_varint(value.size());
+            out.write(value.data(), value.size());
+        }
+
+        std::string decode(snapshot_reader & in) const
+        {
+            std::string value(in.read_varint(), '\0');
+            in.read(&value[0], value.size());
+            return value;
+        }
+    };
+
+    template<class Tree>
+    void check_contents(const Tree & tree, const std::map<std::string, std::string> & expected)
+    {
+        CHECK(tree.size() == expected.size());
+        auto e = expected.begin();
+        for(auto it = tree.cbegin(); it != tree.cend(); ++it, ++e)
+        {
+            CHECK(e != expected.end());
+            CHECK(it.key() == e->first);
+            CHECK(it.value() == e->second);
+        }
+        CHECK(e == expected.end());
+    }
+
+    template<class Tree>
+    bool load_fails(const std::string & bytes)
+    {
+        std::istringstream in(bytes);
+        Tree tree;
+        try
+        {
+            tree.load(in, string_codec());
+        }
+        catch(const std::runtime_error &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(3);
+        for(int round = 0; round != 10; ++round)
+        {
+            Tree tree;
+            std::map<std::string, std::string> expected;
+            for(std::size_t n = random() % 5000; n; --n)
+            {
+                std::string key = random_key(random, "abz/", 24);
+                std::string value(random() % 40, 'v');
+                tree.insert(key, value);
+                expected.emplace(key, value);
+            }
+
+            // two snapshots and some text in one stream, each load stops at the end of its snapshot
+            std::stringstream stream;
+            tree.save(stream, string_codec());
+            tree.save(stream, string_codec());
+            stream << "trailing";
+            Tree first;
+            Tree second;
+            first.load(stream, string_codec());
+            second.load(stream, string_codec());
+            check_contents(first, expected);
+            check_contents(second, expected);
+            std::string rest;
+            stream >> rest;
+            CHECK(rest == "trailing");
+
+            // loading into a tree which is not empty inserts the entries one by one
+            std::stringstream again;
+            tree.save(again, string_codec());
+            second.load(again, string_codec());
+            check_contents(second, expected);
+
+            // truncated snapshots are rejected
+            std::ostringstream out;
+            tree.save(out, string_codec());
+            std::string bytes = out.str();
+            for(int cut = 0; cut != 20; ++cut)
+            {
+                CHECK(load_fails<Tree>(bytes.substr(0, random() % bytes.size())));
+            }
+        }
+
+        CHECK(load_fails<Tree>("not a snapshot"));
+
+        // a suffix length far too large is rejected before the key is resized
+        Tree tree;
+        tree.insert("abc", "value");
+        std::ostringstream out;
+        tree.save(out, string_codec());
+        std::string bytes = out.str();
+        // block length, signature, version, letter size, entry count and shared length fit in one byte each
+        std::size_t suffix = 1 + 8 + 4;
+        CHECK(bytes[suffix] == 3);
+        bytes[suffix] = (char)0xff;
+        bytes.insert(suffix + 1, "\xff\xff\xff\xff\xff\xff\x7f");
+        CHECK(load_fails<Tree>(bytes));
+    }
+}
+
+int main()
+{
+    for_each_tree_config<std::string>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "snapshot_test passed" << std::endl;
+    return 0;
+}
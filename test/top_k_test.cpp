@@ -0,0 +1,142 @@
+// top_k against sorting the entries of a std::map, with scores kept up to date by every way of
+// changing the tree.
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "trees.h"
+
+namespace
+{
+    struct by_value
+    {
+        int operator()(int value) const
+        {
+            return value;
+        }
+    };
+
+    template<class Tree>
+    void check_top_k(const Tree & tree, const std::map<std::string, int> & entries, std::mt19937 & random)
+    {
+        for(int round = 0; round != 50; ++round)
+        {
+            std::string prefix = random_key(random, "abcd", 3);
+            std::size_t k = random() % 12;
+            std::vector<int> expected;
+            for(const auto & entry : entries)
+            {
+                if(entry.first.compare(0, prefix.size(), prefix) == 0)
+                {
+                    expected.push_back(entry.second);
+                }
+            }
+            std::sort(expected.begin(), expected.end(), std::greater<int>());
+            expected.resize(std::min(k, expected.size()));
+
+            std::vector<typename Tree::const_iterator> found;
+            tree.top_k(prefix, k, std::back_inserter(found));
+            CHECK(found.size() == expected.size());
+            for(std::size_t i = 0; i != found.size(); ++i)
+            {
+                CHECK(found[i].value() == expected[i]);
+                CHECK(found[i].key().compare(0, prefix.size(), prefix) == 0);
+                CHECK(entries.at(found[i].key()) == found[i].value());
+            }
+        }
+    }
+
+    template<class Tree>
+    void run()
+    {
+        std::mt19937 random(7);
+        Tree tree;
+        std::map<std::string, int> entries;
+        typename Tree::const_iterator hint = tree.cend();
+        for(int i = 0; i != 6000; ++i)
+        {
+            std::string key = random_key(random, "abcd", 8);
+            int value = (int)(random() % 1000) - 500;
+            switch(random() % 6)
+            {
+            case 0:
+                tree.insert(key, value);
+                entries.emplace(key, value);
+                break;
+            case 1:
+                tree.insert_or_assign(key, value);
+                entries[key] = value;
+                break;
+            case 2:
+                tree.erase(key);
+                entries.erase(key);
+                hint = tree.cend();
+                break;
+            case 3:
+                hint = tree.insert(hint, key, value);
+                entries.emplace(key, value);
+                break;
+            case 4:
+            {
+                auto it = tree.find(key);
+                if(it != tree.end())
+                {
+                    it.value() = value;
+                    tree.rescore(it);
+                    entries[key] = value;
+                }
+                break;
+            }
+            default:
+                tree[key];
+                entries[key];
+                break;
+            }
+            if(i % 500 == 0)
+            {
+                check_top_k(tree, entries, random);
+            }
+        }
+        check_top_k(tree, entries, random);
+
+        std::vector<std::pair<std::string, int> > pairs(entries.begin(), entries.end());
+        Tree bulk;
+        bulk.bulk_load(pairs.begin(), pairs.end());
+        check_top_k(bulk, entries, random);
+        Tree parallel;
+        parallel.parallel_load(pairs.begin(), pairs.end(), 4);
+        check_top_k(parallel, entries, random);
+        std::stringstream stream;
+        tree.save(stream);
+        Tree loaded;
+        loaded.load(stream);
+        check_top_k(loaded, entries, random);
+
+        tree.clear();
+        std::vector<typename Tree::const_iterator> found;
+        tree.top_k("", 5, std::back_inserter(found));
+        CHECK(found.empty());
+    }
+}
+
+int main()
+{
+    for_each_tree_config<int, by_value>([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    for_each_tree_config<int, by_value, arena_allocator<int> >([](auto config)
+    {
+        run<typename decltype(config)::type>();
+    });
+    std::cout << "top_k_test passed" << std::endl;
+    return 0;
+}
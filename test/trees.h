@@ -0,0 +1,39 @@
+#ifndef PREFIX_TREE_TEST_TREES_H
+#define PREFIX_TREE_TEST_TREES_H
+
+#include <memory>
+#include <random>
+#include <string>
+
+#include "../charset.h"
+#include "../prefix_tree.h"
+
+// key of fewer than max_length letters drawn from letters
+inline std::string random_key(std::mt19937 & random, const std::string & letters, std::size_t max_length)
+{
+    std::string key;
+    for(std::size_t n = random() % max_length; n; --n)
+    {
+        key.push_back(letters[random() % letters.size()]);
+    }
+    return key;
+}
+
+template<class Tree>
+struct tree_config
+{
+    typedef Tree type;
+};
+
+// call f(tree_config<Tree>()) for each usual setup of a tree of Mapped values: string prefixes, inline
+// prefixes with handle links, keyless values and string view prefixes
+template<class Mapped, class Score = no_score, class Allocator = std::allocator<Mapped>, class F>
+void for_each_tree_config(F f)
+{
+    f(tree_config<prefix_tree<std::string, Mapped, ascii_charset, string_prefixer_traits, Allocator, pointer_link, keyed_value, Score> >());
+    f(tree_config<prefix_tree<std::string, Mapped, ascii_charset, inline_prefixer_traits, Allocator, handle_link, keyed_value, Score> >());
+    f(tree_config<prefix_tree<std::string, Mapped, ascii_charset, string_prefixer_traits, Allocator, pointer_link, keyless_value, Score> >());
+    f(tree_config<prefix_tree<std::string, Mapped, ascii_charset, basic_string_view_prefixer_traits<char>, Allocator, pointer_link, keyed_value, Score> >());
+}
+
+#endif //PREFIX_TREE_TEST_TREES_H
@@ -0,0 +1,236 @@
+#ifndef PREFIX_TREE_ARENA_ALLOCATOR_H
+#define PREFIX_TREE_ARENA_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Slab arena: single objects are carved out of large slabs, one bump pointer and one free list per
+// size class (8 bytes granularity). Freed objects are reused by the next allocation of the same
+// class and slabs are only given back all at once by release() or the arena destructor.
+// Not thread safe.
+class arena
+{
+public:
+    typedef std::size_t size_type;
+
+    static constexpr size_type granularity = 8;
+    static constexpr size_type class_count = 512;
+    static constexpr size_type slab_size = 64 * 1024;
+
+    arena() noexcept
+    :classes()
+    ,live(0)
+    {
+    }
+
+    arena(const arena &) = delete;
+    arena & operator=(const arena &) = delete;
+
+    ~arena() noexcept
+    {
+        free_slabs();
+    }
+
+    static constexpr bool handles(size_type bytes, size_type alignment) noexcept
+    {
+        return bytes != 0 && bytes <= granularity * class_count && alignment <= granularity;
+    }
+
+    void * allocate(size_type bytes)
+    {
+        size_class & c = classes[(bytes - 1) / granularity];
+        void * result;
+        if(c.free)
+        {
+            result = c.free;
+            c.free = c.free->next;
+        }
+        else
+        {
+            size_type size = ((bytes - 1) / granularity + 1) * granularity;
+            if(c.bump == c.end)
+            {
+                size_type length = size > slab_size / 4 ? size * 4 : slab_size;
+                if(slabs.size() == slabs.capacity())
+                {
+                    slabs.reserve(slabs.size() * 2 + 16);
+                }
+                c.bump = static_cast<char *>(::operator new(length));
+                c.end = c.bump + length / size * size;
+                slabs.push_back(c.bump);
+            }
+            result = c.bump;
+            c.bump += size;
+        }
+        ++live;
+        return result;
+    }
+
+    void deallocate(void * p, size_type bytes) noexcept
+    {
+        size_class & c = classes[(bytes - 1) / granularity];
+        free_slot * slot = static_cast<free_slot *>(p);
+        slot->next = c.free;
+        c.free = slot;
+        --live;
+    }
+
+    // number of objects allocated and not deallocated yet
+    size_type size() const noexcept
+    {
+        return live;
+    }
+
+    // give every slab back at once, only done when no object is alive anymore
+    bool release() noexcept
+    {
+        if(live)
+        {
+            return false;
+        }
+        free_slabs();
+        return true;
+    }
+
+    // give every slab back, objects still allocated from the arena must not be used anymore
+    void reset() noexcept
+    {
+        free_slabs();
+        live = 0;
+    }
+
+private:
+    struct free_slot
+    {
+        free_slot * next;
+    };
+
+    struct size_class
+    {
+        free_slot * free;
+        char * bump;
+        char * end;
+    };
+
+    void free_slabs() noexcept
+    {
+        for(char * slab : slabs)
+        {
+            ::operator delete(slab);
+        }
+        slabs.clear();
+        slabs.shrink_to_fit();
+        for(size_class & c : classes)
+        {
+            c = size_class();
+        }
+    }
+
+    size_class classes[class_count];
+    std::vector<char *> slabs;
+    size_type live;
+};
+
+// Allocator policy backed by a shared arena, copies and rebinds share the same arena so nodes,
+// child containers and value holders of a prefix_tree all come from it. Allocations of more than
+// one object or too large for the arena size classes go to the global operator new.
+template<typename T>
+class arena_allocator
+{
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef arena_allocator<value_type> type;
+
+    template<typename U>
+    struct rebind
+    {
+        typedef arena_allocator<U> other;
+    };
+
+    arena_allocator()
+    :memory(std::make_shared<arena>())
+    {
+    }
+
+    explicit arena_allocator(const std::shared_ptr<arena> & memory) noexcept
+    :memory(memory)
+    {
+    }
+
+    template<typename U>
+    arena_allocator(const arena_allocator<U> & allocator) noexcept
+    :memory(allocator.get_arena())
+    {
+    }
+
+    value_type * allocate(size_type n)
+    {
+        if(n == 1 && arena::handles(sizeof(value_type), alignof(value_type)))
+        {
+            return static_cast<value_type *>(memory->allocate(sizeof(value_type)));
+        }
+        return static_cast<value_type *>(::operator new(n * sizeof(value_type), std::align_val_t(alignof(value_type))));
+    }
+
+    void deallocate(value_type * p, size_type n) noexcept
+    {
+        if(n == 1 && arena::handles(sizeof(value_type), alignof(value_type)))
+        {
+            memory->deallocate(p, sizeof(value_type));
+        }
+        else
+        {
+            ::operator delete(p, std::align_val_t(alignof(value_type)));
+        }
+    }
+
+    // called by prefix_tree::clear once every object has been destroyed
+    void release() noexcept
+    {
+        memory->release();
+    }
+
+    // whether the arena is shared by the given number of allocators only
+    bool owned_by(long copies) const noexcept
+    {
+        return memory.use_count() == copies;
+    }
+
+    // called by prefix_tree::clear when it owns the arena, objects are destroyed but not deallocated
+    void reset() noexcept
+    {
+        memory->reset();
+    }
+
+    // single objects come from the arena and are given back by reset
+    static constexpr bool bulk_released() noexcept
+    {
+        return arena::handles(sizeof(value_type), alignof(value_type));
+    }
+
+    const std::shared_ptr<arena> & get_arena() const noexcept
+    {
+        return memory;
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U> & right) const noexcept
+    {
+        return memory == right.get_arena();
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U> & right) const noexcept
+    {
+        return memory != right.get_arena();
+    }
+
+private:
+    std::shared_ptr<arena> memory;
+};
+
+#endif //PREFIX_TREE_ARENA_ALLOCATOR_H
@@ -0,0 +1,182 @@
+#ifndef PREFIX_TREE_BIT_VECTOR_H
+#define PREFIX_TREE_BIT_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline unsigned popcount64(std::uint64_t word) noexcept
+{
+#if defined(_MSC_VER)
+    return (unsigned)__popcnt64(word);
+#else
+    return (unsigned)__builtin_popcountll(word);
+#endif
+}
+
+inline unsigned count_trailing_zeros64(std::uint64_t word) noexcept
+{
+#if defined(_MSC_VER)
+    unsigned long result;
+    _BitScanForward64(&result, word);
+    return (unsigned)result;
+#else
+    return (unsigned)__builtin_ctzll(word);
+#endif
+}
+
+// Append only bit vector with rank and select. Once filled, build_index counts the ones before
+// each block of 512 bits (12.5% of space), rank reads one count and at most 8 words, select binary
+// searches the counts then scans one block.
+class bit_vector
+{
+public:
+    typedef std::size_t size_type;
+
+    static constexpr size_type block_words = 8;
+    static constexpr size_type block_bits = block_words * 64;
+
+    bit_vector() noexcept
+    :length(0)
+    {
+    }
+
+    void push_back(bool bit)
+    {
+        if(length % 64 == 0)
+        {
+            words.push_back(0);
+        }
+        if(bit)
+        {
+            words.back() |= std::uint64_t(1) << (length % 64);
+        }
+        ++length;
+    }
+
+    bool operator[](size_type i) const noexcept
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    size_type size() const noexcept
+    {
+        return length;
+    }
+
+    // to call once every bit has been pushed
+    void build_index()
+    {
+        size_type count = (words.size() + block_words - 1) / block_words;
+        blocks.assign(count + 1, 0);
+        size_type ones = 0;
+        for(size_type w = 0; w != words.size(); ++w)
+        {
+            if(w % block_words == 0)
+            {
+                blocks[w / block_words] = ones;
+            }
+            ones += popcount64(words[w]);
+        }
+        blocks[count] = ones;
+        words.shrink_to_fit();
+    }
+
+    // ones in [0, i)
+    size_type rank1(size_type i) const noexcept
+    {
+        size_type block = i / block_bits;
+        size_type result = blocks[block];
+        for(size_type w = block * block_words; w != i / 64; ++w)
+        {
+            result += popcount64(words[w]);
+        }
+        if(i % 64)
+        {
+            result += popcount64(words[i / 64] & ((std::uint64_t(1) << (i % 64)) - 1));
+        }
+        return result;
+    }
+
+    size_type rank0(size_type i) const noexcept
+    {
+        return i - rank1(i);
+    }
+
+    size_type count1() const noexcept
+    {
+        return blocks.back();
+    }
+
+    // position of the one of rank j, j starting at 0
+    size_type select1(size_type j) const noexcept
+    {
+        return select<true>(j);
+    }
+
+    // position of the zero of rank j, j starting at 0
+    size_type select0(size_type j) const noexcept
+    {
+        return select<false>(j);
+    }
+
+    size_type bytes() const noexcept
+    {
+        return words.size() * sizeof(std::uint64_t) + blocks.size() * sizeof(size_type);
+    }
+
+private:
+    template<bool One>
+    size_type ones_before(size_type block) const noexcept
+    {
+        return One ? blocks[block] : block * block_bits - blocks[block];
+    }
+
+    template<bool One>
+    std::uint64_t word(size_type w) const noexcept
+    {
+        return One ? words[w] : ~words[w];
+    }
+
+    template<bool One>
+    size_type select(size_type j) const noexcept
+    {
+        size_type low = 0;
+        size_type high = blocks.size() - 1;
+        while(high - low > 1) // last block whose count is not greater than j
+        {
+            size_type middle = (low + high) / 2;
+            if(ones_before<One>(middle) <= j)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        j -= ones_before<One>(low);
+        size_type w = low * block_words;
+        for(size_type count = popcount64(word<One>(w)); count <= j; count = popcount64(word<One>(w)))
+        {
+            j -= count;
+            ++w;
+        }
+        std::uint64_t bits = word<One>(w);
+        for(; j; --j)
+        {
+            bits &= bits - 1;
+        }
+        return w * 64 + count_trailing_zeros64(bits);
+    }
+
+    std::vector<std::uint64_t> words;
+    std::vector<size_type> blocks;
+    size_type length;
+};
+
+#endif //PREFIX_TREE_BIT_VECTOR_H
@@ -0,0 +1,248 @@
+#ifndef PREFIX_TREE_EPOCH_H
+#define PREFIX_TREE_EPOCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class epoch_manager;
+
+// Pin held by a reader, objects it can reach are not released before it goes out of scope
+class epoch_guard
+{
+public:
+    typedef std::size_t size_type;
+
+    epoch_guard(const epoch_manager * manager, size_type slot) noexcept
+    :manager(manager)
+    ,slot(slot)
+    {
+    }
+
+    epoch_guard(const epoch_guard &) = delete;
+    epoch_guard & operator=(const epoch_guard &) = delete;
+
+    epoch_guard(epoch_guard && other) noexcept
+    :manager(other.manager)
+    ,slot(other.slot)
+    {
+        other.manager = nullptr;
+    }
+
+    epoch_guard & operator=(epoch_guard && other) noexcept
+    {
+        std::swap(manager, other.manager);
+        std::swap(slot, other.slot);
+        return *this;
+    }
+
+    inline ~epoch_guard() noexcept;
+
+private:
+    const epoch_manager * manager;
+    size_type slot;
+};
+
+// Epoch based reclamation for structures read without locks. A reader pins the global epoch in a
+// slot of its own while it reads, a writer retires the objects it unlinks with the current epoch.
+// The epoch only moves forward when every pinned reader has seen it, so an object retired in epoch e
+// is released once the epoch reaches e + 2: no reader pinned before the unlink is left.
+// Any number of threads pin and retire. Retired objects go to limbo lists kept per slot, a thread using
+// the lists of the slot it last pinned, so writers pinned at once do not share a lock. Moving the epoch
+// forward takes the lists of every slot, one thread at a time: threads reaching the collect period while
+// another one does it go on without waiting, but this pass over the slots is not spread over the cores.
+// Only measured on a single core.
+class epoch_manager
+{
+public:
+    typedef std::size_t size_type;
+    typedef std::uint64_t epoch_type;
+    typedef void (*deleter_type)(void *);
+
+    // retired objects between two attempts to move the epoch forward
+    static constexpr size_type collect_period = 64;
+
+    // slots bound the number of readers pinned at once, more readers wait for a free slot
+    explicit epoch_manager(size_type slots = 256)
+    :slots(new slot_type[slots])
+    ,limbos(new limbo_type[slots])
+    ,slot_count(slots)
+    ,global(1)
+    {
+    }
+
+    epoch_manager(const epoch_manager &) = delete;
+    epoch_manager & operator=(const epoch_manager &) = delete;
+
+    // no reader may be pinned anymore
+    ~epoch_manager() noexcept
+    {
+        for(size_type s = 0; s != slot_count; ++s)
+        {
+            for(std::vector<retired> & list : limbos[s].lists)
+            {
+                release(list);
+            }
+        }
+    }
+
+    epoch_guard pin() const
+    {
+        size_type & hint = thread_slot();
+        while(true)
+        {
+            for(size_type i = 0; i != slot_count; ++i)
+            {
+                size_type s = (hint + i) % slot_count;
+                epoch_type e = global.load();
+                epoch_type expected = 0;
+                if(slots[s].state.compare_exchange_strong(expected, announce(e)))
+                {
+                    // the epoch may have moved before the slot was visible, announce the last one
+                    for(epoch_type now = global.load(); now != e; now = global.load())
+                    {
+                        e = now;
+                        slots[s].state.store(announce(e));
+                    }
+                    hint = s;
+                    return epoch_guard(this, s);
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // release p with deleter once no reader can reach it, p must already be unlinked
+    void retire(void * p, deleter_type deleter)
+    {
+        limbo_type & limbo = limbos[thread_slot() % slot_count];
+        {
+            std::lock_guard<std::mutex> lock(limbo.lock);
+            limbo.lists[global.load() % 3].push_back(retired{p, deleter});
+            if(++limbo.pending < collect_period)
+            {
+                return;
+            }
+            limbo.pending = 0;
+        }
+        std::unique_lock<std::mutex> lock(advancing, std::try_to_lock);
+        if(lock)
+        {
+            advance();
+        }
+    }
+
+    template<typename T>
+    void retire(T * p)
+    {
+        retire(p, [](void * q) { delete static_cast<T *>(q); });
+    }
+
+    // move the epoch forward when every pinned reader has seen it, releasing what was retired two epochs ago
+    bool try_advance()
+    {
+        std::lock_guard<std::mutex> lock(advancing);
+        return advance();
+    }
+
+    epoch_type epoch() const noexcept
+    {
+        return global.load();
+    }
+
+private:
+    friend epoch_guard;
+
+    struct alignas(64) slot_type
+    {
+        std::atomic<epoch_type> state{0};   // 0 when free, epoch * 2 + 1 when pinned
+    };
+
+    struct retired
+    {
+        void * p;
+        deleter_type deleter;
+    };
+
+    // objects retired by the threads using a slot, by epoch modulo 3
+    struct alignas(64) limbo_type
+    {
+        std::mutex lock;
+        std::vector<retired> lists[3];
+        size_type pending = 0;
+    };
+
+    // slot last pinned by the calling thread
+    static size_type & thread_slot() noexcept
+    {
+        static thread_local size_type hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return hint;
+    }
+
+    // to call with advancing locked. An object is retired with the epoch read under the lock of its list,
+    // so once the epoch is e + 1 the lists of e - 1 get nothing new.
+    bool advance()
+    {
+        epoch_type e = global.load();
+        for(size_type s = 0; s != slot_count; ++s)
+        {
+            epoch_type state = slots[s].state.load();
+            if(state && (state >> 1) != e)
+            {
+                return false;
+            }
+        }
+        global.store(e + 1);
+        std::vector<retired> expired;
+        for(size_type s = 0; s != slot_count; ++s)
+        {
+            limbo_type & limbo = limbos[s];
+            {
+                std::lock_guard<std::mutex> lock(limbo.lock);
+                expired.swap(limbo.lists[(e + 2) % 3]);
+            }
+            release(expired);
+        }
+        return true;
+    }
+
+    static epoch_type announce(epoch_type e) noexcept
+    {
+        return (e << 1) | 1;
+    }
+
+    void unpin(size_type s) const noexcept
+    {
+        slots[s].state.store(0, std::memory_order_release);
+    }
+
+    static void release(std::vector<retired> & list) noexcept
+    {
+        for(const retired & r : list)
+        {
+            r.deleter(r.p);
+        }
+        list.clear();
+    }
+
+    std::unique_ptr<slot_type[]> slots;
+    std::unique_ptr<limbo_type[]> limbos;
+    size_type slot_count;
+    std::atomic<epoch_type> global;
+    std::mutex advancing;
+};
+
+inline epoch_guard::~epoch_guard() noexcept
+{
+    if(manager)
+    {
+        manager->unpin(slot);
+    }
+}
+
+#endif //PREFIX_TREE_EPOCH_H
@@ -0,0 +1,183 @@
+#ifndef PREFIX_TREE_INLINE_PREFIX_H
+#define PREFIX_TREE_INLINE_PREFIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// Immutable sequence of letters kept inside the object up to N letters, longer ones are spilled
+// to memory obtained from Allocator. With char letters and N = 15 the object takes 16 bytes.
+template<class CharT, std::size_t N = 15, class Allocator = std::allocator<CharT> >
+class inline_prefix
+{
+public:
+    typedef CharT value_type;
+    typedef std::size_t size_type;
+    typedef Allocator allocator_type;
+    typedef inline_prefix<value_type, N, allocator_type> type;
+    typedef const value_type * const_iterator;
+    typedef const value_type * iterator;
+
+    static_assert(std::is_trivially_copyable<value_type>::value, "letters are copied as bytes");
+    static_assert(N < 255, "the inline length is stored in a byte");
+
+    static constexpr size_type inline_capacity = N;
+
+    inline_prefix() noexcept
+    :length_(0)
+    {
+    }
+
+    inline_prefix(const value_type * s, size_type n)
+    :length_(0)
+    {
+        assign(s, n);
+    }
+
+    inline_prefix(const inline_prefix & other)
+    :length_(0)
+    {
+        assign(other.data(), other.size());
+    }
+
+    inline_prefix(inline_prefix && other) noexcept
+    :length_(0)
+    {
+        steal(other);
+    }
+
+    ~inline_prefix() noexcept
+    {
+        release();
+    }
+
+    inline_prefix & operator=(const inline_prefix & other)
+    {
+        if(this != &other)
+        {
+            inline_prefix copy(other);
+            release();
+            steal(copy);
+        }
+        return *this;
+    }
+
+    inline_prefix & operator=(inline_prefix && other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    const value_type * data() const noexcept
+    {
+        return spilled() ? remote_data() : reinterpret_cast<const value_type *>(bytes);
+    }
+
+    size_type size() const noexcept
+    {
+        return spilled() ? remote_size() : length_;
+    }
+
+    size_type length() const noexcept
+    {
+        return size();
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    bool spilled() const noexcept
+    {
+        return length_ == spilled_tag;
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return data();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return data() + size();
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+private:
+    static constexpr unsigned char spilled_tag = 0xff;
+    static constexpr size_type storage_size = N * sizeof(value_type);
+
+    static_assert(storage_size >= sizeof(value_type *) + sizeof(std::uint32_t), "a spilled prefix keeps its pointer and length inline");
+
+    // a spilled prefix keeps its pointer then its 32 bits length at the start of bytes
+    value_type * remote_data() const noexcept
+    {
+        value_type * p;
+        std::memcpy(&p, bytes, sizeof(p));
+        return p;
+    }
+
+    std::uint32_t remote_size() const noexcept
+    {
+        std::uint32_t n;
+        std::memcpy(&n, bytes + sizeof(value_type *), sizeof(n));
+        return n;
+    }
+
+    void assign(const value_type * s, size_type n)
+    {
+        if(n <= N)
+        {
+            std::memcpy(bytes, s, n * sizeof(value_type));
+            length_ = (unsigned char)n;
+        }
+        else
+        {
+            allocator_type allocator;
+            value_type * p = allocator.allocate(n);
+            std::memcpy(p, s, n * sizeof(value_type));
+            std::uint32_t length = (std::uint32_t)n;
+            std::memcpy(bytes, &p, sizeof(p));
+            std::memcpy(bytes + sizeof(p), &length, sizeof(length));
+            length_ = spilled_tag;
+        }
+    }
+
+    void steal(inline_prefix & other) noexcept
+    {
+        std::memcpy(bytes, other.bytes, storage_size);
+        length_ = other.length_;
+        other.length_ = 0;
+    }
+
+    void release() noexcept
+    {
+        if(spilled())
+        {
+            allocator_type allocator;
+            allocator.deallocate(remote_data(), remote_size());
+        }
+        length_ = 0;
+    }
+
+    alignas(value_type *) unsigned char bytes[storage_size];
+    unsigned char length_;
+};
+
+#endif //PREFIX_TREE_INLINE_PREFIX_H
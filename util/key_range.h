@@ -0,0 +1,44 @@
+#ifndef PREFIX_TREE_KEY_RANGE_H
+#define PREFIX_TREE_KEY_RANGE_H
+
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Letters of a key given to a lookup. Anything viewed as a basic_string_view of letters (key strings,
+// string views, C strings, letter arrays) is read in place through pointers, which keeps prefix
+// matching vectorized. Other ranges are read through their own iterators when they give letters.
+template<typename Letter, typename Key, typename = void>
+struct key_range
+{
+    static constexpr bool value = false;
+};
+
+template<typename Letter, typename Key>
+struct key_range<Letter, Key, typename std::enable_if<std::is_convertible<const Key &, std::basic_string_view<Letter> >::value>::type>
+{
+    static constexpr bool value = true;
+    typedef const Letter * iterator;
+
+    static std::pair<iterator, iterator> letters(const Key & key) noexcept
+    {
+        std::basic_string_view<Letter> view(key);
+        return std::make_pair(view.data(), view.data() + view.size());
+    }
+};
+
+template<typename Letter, typename Key>
+struct key_range<Letter, Key, typename std::enable_if<!std::is_convertible<const Key &, std::basic_string_view<Letter> >::value
+    && std::is_same<typename std::remove_cv<typename std::iterator_traits<decltype(std::begin(std::declval<const Key &>()))>::value_type>::type, Letter>::value>::type>
+{
+    static constexpr bool value = true;
+    typedef decltype(std::begin(std::declval<const Key &>())) iterator;
+
+    static std::pair<iterator, iterator> letters(const Key & key)
+    {
+        return std::make_pair(std::begin(key), std::end(key));
+    }
+};
+
+#endif //PREFIX_TREE_KEY_RANGE_H
@@ -0,0 +1,127 @@
+#ifndef PREFIX_TREE_MAPPED_FILE_H
+#define PREFIX_TREE_MAPPED_FILE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File mapped in memory as a whole, read only when opened and read write when created.
+// The mapping is released with the object. POSIX only.
+class mapped_file
+{
+public:
+    typedef std::size_t size_type;
+
+    mapped_file() noexcept
+    :memory(nullptr)
+    ,length(0)
+    {
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file & operator=(const mapped_file &) = delete;
+
+    mapped_file(mapped_file && other) noexcept
+    :memory(other.memory)
+    ,length(other.length)
+    {
+        other.memory = nullptr;
+        other.length = 0;
+    }
+
+    mapped_file & operator=(mapped_file && other) noexcept
+    {
+        std::swap(memory, other.memory);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    ~mapped_file() noexcept
+    {
+        if(memory)
+        {
+            ::munmap(memory, length);
+        }
+    }
+
+    static mapped_file open(const std::string & path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat status;
+        if(::fstat(fd, &status) != 0)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        return map(fd, (size_type)status.st_size, PROT_READ, path);
+    }
+
+    // create or truncate the file at path to size bytes
+    static mapped_file create(const std::string & path, size_type size)
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        if(::ftruncate(fd, (off_t)size) != 0)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        return map(fd, size, PROT_READ | PROT_WRITE, path);
+    }
+
+    const char * data() const noexcept
+    {
+        return static_cast<const char *>(memory);
+    }
+
+    char * data() noexcept
+    {
+        return static_cast<char *>(memory);
+    }
+
+    size_type size() const noexcept
+    {
+        return length;
+    }
+
+private:
+    static mapped_file map(int fd, size_type size, int protection, const std::string & path)
+    {
+        mapped_file result;
+        if(size)
+        {
+            void * p = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+            if(p == MAP_FAILED)
+            {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), path);
+            }
+            result.memory = p;
+            result.length = size;
+        }
+        ::close(fd);
+        return result;
+    }
+
+    void * memory;
+    size_type length;
+};
+
+#endif //PREFIX_TREE_MAPPED_FILE_H
@@ -5,6 +5,10 @@
 #ifndef PREFIX_TREE_MEMORY_H
 #define PREFIX_TREE_MEMORY_H
 
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 template<class Allocator>
 class unique_allocation
 {
@@ -86,4 +90,77 @@ private:
     allocator_type & allocator;
 };
 
+// give the memory of an allocator back once the container released every object allocated from it,
+// only allocators with a release() member (arena_allocator) have something to do.
+// owned_by tells whether the container holds every copy of the allocator, reset then gives its memory
+// back even though objects were dropped without being deallocated, see bulk_released
+template<class Allocator, class = void>
+struct allocator_releaser
+{
+    static void release(Allocator & allocator) noexcept
+    {
+    }
+
+    static bool owned_by(const Allocator & allocator, long copies) noexcept
+    {
+        return false;
+    }
+
+    static void reset(Allocator & allocator) noexcept
+    {
+    }
+};
+
+template<class Allocator>
+struct allocator_releaser<Allocator, std::void_t<decltype(std::declval<Allocator &>().release())> >
+{
+    static void release(Allocator & allocator) noexcept
+    {
+        allocator.release();
+    }
+
+    static bool owned_by(const Allocator & allocator, long copies) noexcept
+    {
+        return allocator.owned_by(copies);
+    }
+
+    static void reset(Allocator & allocator) noexcept
+    {
+        allocator.reset();
+    }
+};
+
+// whether single objects of an allocator are given back by allocator_releaser::reset, so that a
+// container dropping all its objects at once does not need to deallocate them one by one
+template<class Allocator, class = void>
+struct bulk_released : std::false_type
+{
+};
+
+template<class Allocator>
+struct bulk_released<Allocator, std::void_t<decltype(Allocator::bulk_released())> > : std::integral_constant<bool, Allocator::bulk_released()>
+{
+};
+
+// deallocate a single object unless the allocator releases it in bulk
+template<class Allocator>
+void drop_allocation(Allocator & allocator, typename Allocator::value_type * p) noexcept
+{
+    if constexpr(!bulk_released<Allocator>::value)
+    {
+        allocator.deallocate(p, 1);
+    }
+}
+
+// allocators whose copies can allocate and deallocate from several threads at once
+template<class Allocator>
+struct concurrent_allocator : std::false_type
+{
+};
+
+template<class T>
+struct concurrent_allocator<std::allocator<T> > : std::true_type
+{
+};
+
 #endif //PREFIX_TREE_MEMORY_H
@@ -0,0 +1,123 @@
+#ifndef PREFIX_TREE_MISMATCH_H
+#define PREFIX_TREE_MISMATCH_H
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PREFIX_TREE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define PREFIX_TREE_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline unsigned count_trailing_zeros(unsigned mask) noexcept
+{
+#if defined(_MSC_VER)
+    unsigned long result;
+    _BitScanForward(&result, mask);
+    return (unsigned)result;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// position of the first byte differing between left and right, n if the n first bytes are equal
+inline std::size_t mismatch_length(const char * left, const char * right, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+#if defined(PREFIX_TREE_AVX2)
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + i));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(right + i));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(l, r));
+        if(mask)
+        {
+            return i + count_trailing_zeros(mask);
+        }
+    }
+#endif
+#if defined(PREFIX_TREE_SSE2)
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) & 0xffffu;
+        if(mask)
+        {
+            return i + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    for(; i != n && left[i] == right[i]; ++i);
+    return i;
+}
+
+// iterators over letters stored contiguously: pointers and std::basic_string iterators
+template<typename Iterator>
+struct is_contiguous_iterator
+{
+    typedef typename std::remove_cv<typename std::iterator_traits<Iterator>::value_type>::type letter_type;
+    static constexpr bool value = std::is_pointer<Iterator>::value
+                                  || std::is_same<Iterator, typename std::basic_string<letter_type>::iterator>::value
+                                  || std::is_same<Iterator, typename std::basic_string<letter_type>::const_iterator>::value;
+};
+
+// charsets whose index of a letter is the letter itself declare a true identity member
+template<typename Charset, typename = void>
+struct is_identity_charset : std::false_type
+{
+};
+
+template<typename Charset>
+struct is_identity_charset<Charset, typename std::enable_if<Charset::identity>::type> : std::true_type
+{
+};
+
+// advance pi and start while the prefix and the key agree
+template<typename Charset, typename PrefixIterator, typename KeyIterator, bool Vectorized =
+    is_identity_charset<Charset>::value
+    && is_contiguous_iterator<PrefixIterator>::value
+    && is_contiguous_iterator<KeyIterator>::value
+    && sizeof(typename std::iterator_traits<PrefixIterator>::value_type) == 1
+    && sizeof(typename std::iterator_traits<KeyIterator>::value_type) == 1>
+struct prefix_matcher
+{
+    static void match(const Charset & abc, PrefixIterator & pi, PrefixIterator pend, KeyIterator & start, KeyIterator last)
+    {
+        for(; pi != pend && start != last && abc.to_int_type(*pi) == abc.to_int_type(*start); ++pi, ++start);
+    }
+};
+
+template<typename Charset, typename PrefixIterator, typename KeyIterator>
+struct prefix_matcher<Charset, PrefixIterator, KeyIterator, true>
+{
+    static void match(const Charset & abc, PrefixIterator & pi, PrefixIterator pend, KeyIterator & start, KeyIterator last)
+    {
+        auto prefix_length = std::distance(pi, pend);
+        auto key_length = std::distance(start, last);
+        std::size_t n = (std::size_t)(prefix_length < key_length ? prefix_length : key_length);
+        if(n)
+        {
+            std::size_t length = mismatch_length(reinterpret_cast<const char *>(&*pi), reinterpret_cast<const char *>(&*start), n);
+            pi += length;
+            start += length;
+        }
+    }
+};
+
+template<typename Charset, typename PrefixIterator, typename KeyIterator>
+inline void match_prefix(const Charset & abc, PrefixIterator & pi, PrefixIterator pend, KeyIterator & start, KeyIterator last)
+{
+    prefix_matcher<Charset, PrefixIterator, KeyIterator>::match(abc, pi, pend, start, last);
+}
+
+#endif //PREFIX_TREE_MISMATCH_H
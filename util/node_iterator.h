@@ -24,12 +24,11 @@ public:
     :it(it)
     ,end(end)
     {
-        for(; it != end && !it->second; ++it);
     }
 
     type & operator ++()
     {
-        for(++it; it != end && !it->second; ++it);
+        ++it;
         return *this;
     }
 
@@ -45,7 +44,7 @@ public:
 
     node_ptr operator *() const
     {
-        return it->second.get();
+        return *it;
     }
 
 private:
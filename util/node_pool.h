@@ -0,0 +1,219 @@
+#ifndef PREFIX_TREE_NODE_POOL_H
+#define PREFIX_TREE_NODE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Pool of fixed size objects addressed by 32 bits handles, 0 being the null handle.
+// Objects live in chunks aligned on their own size, whose header points back to the pool, so the
+// pool and the handle of an object are found from its address alone. Freed handles are reused
+// first. Not thread safe.
+template<typename T>
+class node_pool
+{
+public:
+    typedef std::size_t size_type;
+    typedef std::uint32_t handle_type;
+    typedef T value_type;
+    typedef node_pool<value_type> type;
+
+    static constexpr size_type chunk_size = size_type(1) << 18;
+
+    node_pool() noexcept
+    :free(0)
+    ,fresh(0)
+    ,live(0)
+    {
+    }
+
+    node_pool(const node_pool &) = delete;
+    node_pool & operator=(const node_pool &) = delete;
+
+    ~node_pool() noexcept
+    {
+        free_chunks();
+    }
+
+    value_type * allocate()
+    {
+        handle_type h;
+        if(free)
+        {
+            h = free;
+            free = *reinterpret_cast<handle_type *>(get(h));
+        }
+        else
+        {
+            if(fresh == std::numeric_limits<handle_type>::max())
+            {
+                throw std::bad_alloc();
+            }
+            if(fresh % per_chunk() == 0)
+            {
+                add_chunk();
+            }
+            h = ++fresh;
+        }
+        ++live;
+        return get(h);
+    }
+
+    void deallocate(value_type * p) noexcept
+    {
+        *reinterpret_cast<handle_type *>(p) = free;
+        free = handle_of(p);
+        --live;
+    }
+
+    value_type * get(handle_type h) const noexcept
+    {
+        size_type i = h - 1;
+        return reinterpret_cast<value_type *>(chunks[i / per_chunk()] + header_size() + (i % per_chunk()) * sizeof(value_type));
+    }
+
+    static handle_type handle_of(const value_type * p) noexcept
+    {
+        const chunk_header * header = header_of(p);
+        size_type offset = reinterpret_cast<const char *>(p) - reinterpret_cast<const char *>(header) - header_size();
+        return (handle_type)(header->first + offset / sizeof(value_type) + 1);
+    }
+
+    static type * of(const value_type * p) noexcept
+    {
+        return header_of(p)->pool;
+    }
+
+    // number of objects allocated and not deallocated yet
+    size_type size() const noexcept
+    {
+        return live;
+    }
+
+    // give every chunk back at once, only done when no object is alive anymore
+    bool release() noexcept
+    {
+        if(live)
+        {
+            return false;
+        }
+        free_chunks();
+        return true;
+    }
+
+private:
+    struct chunk_header
+    {
+        type * pool;
+        size_type first;
+    };
+
+    static constexpr size_type header_size() noexcept
+    {
+        return (sizeof(chunk_header) + alignof(value_type) - 1) / alignof(value_type) * alignof(value_type);
+    }
+
+    static constexpr size_type per_chunk() noexcept
+    {
+        return (chunk_size - header_size()) / sizeof(value_type);
+    }
+
+    static const chunk_header * header_of(const value_type * p) noexcept
+    {
+        return reinterpret_cast<const chunk_header *>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(chunk_size - 1));
+    }
+
+    void add_chunk()
+    {
+        if(chunks.size() == chunks.capacity())
+        {
+            chunks.reserve(chunks.size() * 2 + 16);
+        }
+        char * chunk = static_cast<char *>(::operator new(chunk_size, std::align_val_t(chunk_size)));
+        new((void *)chunk) chunk_header{this, chunks.size() * per_chunk()};
+        chunks.push_back(chunk);
+    }
+
+    void free_chunks() noexcept
+    {
+        for(char * chunk : chunks)
+        {
+            ::operator delete(chunk, std::align_val_t(chunk_size));
+        }
+        chunks.clear();
+        chunks.shrink_to_fit();
+        free = 0;
+        fresh = 0;
+    }
+
+    std::vector<char *> chunks;
+    handle_type free;
+    handle_type fresh;
+    size_type live;
+};
+
+// Allocator of single objects from a shared node_pool, used as node allocator by the handle links.
+template<typename T>
+class pool_allocator
+{
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef pool_allocator<value_type> type;
+    typedef node_pool<value_type> pool_type;
+
+    pool_allocator()
+    :pool(std::make_shared<pool_type>())
+    {
+    }
+
+    // the pool does not come from the given allocator, a new one is created
+    template<class Allocator>
+    explicit pool_allocator(const Allocator &)
+    :pool(std::make_shared<pool_type>())
+    {
+    }
+
+    pool_allocator(const pool_allocator & allocator) noexcept
+    :pool(allocator.pool)
+    {
+    }
+
+    value_type * allocate(size_type n)
+    {
+        if(n != 1)
+        {
+            throw std::bad_alloc();
+        }
+        return pool->allocate();
+    }
+
+    void deallocate(value_type * p, size_type) noexcept
+    {
+        pool->deallocate(p);
+    }
+
+    const std::shared_ptr<pool_type> & get_pool() const noexcept
+    {
+        return pool;
+    }
+
+    bool operator==(const pool_allocator & right) const noexcept
+    {
+        return pool == right.pool;
+    }
+
+    bool operator!=(const pool_allocator & right) const noexcept
+    {
+        return pool != right.pool;
+    }
+
+private:
+    std::shared_ptr<pool_type> pool;
+};
+
+#endif //PREFIX_TREE_NODE_POOL_H
@@ -0,0 +1,73 @@
+#ifndef PREFIX_TREE_OPTIMISTIC_LOCK_H
+#define PREFIX_TREE_OPTIMISTIC_LOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Version lock for optimistic lock coupling. A writer reads the version of the nodes it goes through
+// without locking them, then locks the ones it modifies by upgrading the version it read: the upgrade
+// fails when another writer changed the node in between, and the writer starts again.
+// version: counter << 2 | obsolete << 1 | locked
+class optimistic_lock
+{
+public:
+    typedef std::uint64_t version_type;
+
+    optimistic_lock() noexcept
+    :version(0)
+    {
+    }
+
+    // version of an unlocked state, waits while a writer holds the lock
+    version_type read() const noexcept
+    {
+        version_type v = version.load(std::memory_order_acquire);
+        for(unsigned spins = 0; v & locked_bit; v = version.load(std::memory_order_acquire))
+        {
+            if(++spins % 64 == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        return v;
+    }
+
+    // true when nothing changed since v was read
+    bool validate(version_type v) const noexcept
+    {
+        return version.load(std::memory_order_acquire) == v;
+    }
+
+    // lock when nothing changed since v was read and the node is still in use
+    bool try_upgrade(version_type v) noexcept
+    {
+        return !obsolete(v) && version.compare_exchange_strong(v, v | locked_bit, std::memory_order_acquire);
+    }
+
+    void unlock() noexcept
+    {
+        version.store((version.load(std::memory_order_relaxed) & ~flags) + step, std::memory_order_release);
+    }
+
+    // unlock a node which has been unlinked, upgrades of its versions fail from now on
+    void unlock_obsolete() noexcept
+    {
+        version.store(((version.load(std::memory_order_relaxed) & ~flags) + step) | obsolete_bit, std::memory_order_release);
+    }
+
+    static bool obsolete(version_type v) noexcept
+    {
+        return (v & obsolete_bit) != 0;
+    }
+
+private:
+    static constexpr version_type locked_bit = 1;
+    static constexpr version_type obsolete_bit = 2;
+    static constexpr version_type flags = locked_bit | obsolete_bit;
+    static constexpr version_type step = 4;
+
+    std::atomic<version_type> version;
+};
+
+#endif //PREFIX_TREE_OPTIMISTIC_LOCK_H
@@ -0,0 +1,30 @@
+#ifndef PREFIX_TREE_PREFETCH_H
+#define PREFIX_TREE_PREFETCH_H
+
+#include <cstddef>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+// hint the cache line holding p will be read soon, p does not need to be valid
+inline void prefetch_read(const void * p) noexcept
+{
+#if defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char *>(p), _MM_HINT_T0);
+#else
+    __builtin_prefetch(p, 0, 3);
+#endif
+}
+
+// prefetch every cache line of [p, p + bytes)
+inline void prefetch_read(const void * p, std::size_t bytes) noexcept
+{
+    const char * c = static_cast<const char *>(p);
+    for(std::size_t offset = 0; offset < bytes; offset += 64)
+    {
+        prefetch_read(c + offset);
+    }
+}
+
+#endif //PREFIX_TREE_PREFETCH_H
@@ -11,4 +11,12 @@ struct own_memory;
 struct readonly_type;
 struct readwrite_type;
 
+struct pointer_link;
+struct handle_link;
+
+struct keyed_value;
+struct keyless_value;
+
+struct no_score;
+
 #endif //PREFIX_TREE_TYPES_H
@@ -0,0 +1,48 @@
+#ifndef PREFIX_TREE_VALUE_SCORE_H
+#define PREFIX_TREE_VALUE_SCORE_H
+
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "util/types.h"
+
+// Best score kept by a node for the values of its sub tree, used by prefix_tree::top_k.
+// Score is a default constructible function object giving an arithmetic score for a value,
+// no_score keeps nothing.
+template<typename Score, typename Value>
+class score_cache
+{
+public:
+    typedef typename std::decay<decltype(std::declval<const Score &>()(std::declval<const Value &>()))>::type score_type;
+
+    static constexpr bool scored = true;
+
+    static score_type score(const Value & value)
+    {
+        return Score()(value);
+    }
+
+    // score of a sub tree without values
+    static constexpr score_type lowest() noexcept
+    {
+        return std::numeric_limits<score_type>::lowest();
+    }
+
+    score_type subtree_score() const noexcept
+    {
+        return best;
+    }
+
+protected:
+    score_type best = lowest();
+};
+
+template<typename Value>
+class score_cache<no_score, Value>
+{
+public:
+    static constexpr bool scored = false;
+};
+
+#endif //PREFIX_TREE_VALUE_SCORE_H
@@ -0,0 +1,81 @@
+#ifndef PREFIX_TREE_VALUE_STORAGE_H
+#define PREFIX_TREE_VALUE_STORAGE_H
+
+#include <new>
+#include <tuple>
+#include <utility>
+
+#include "util/types.h"
+
+// What a node keeps for a stored entry.
+// keyed_value: a (key, value) pair, the key is returned by iterators as is.
+// keyless_value: the value alone, the key is rebuilt from the path by iterators.
+template<typename K, typename V, typename Storage>
+struct value_storage;
+
+template<typename K, typename V>
+struct value_storage<K, V, keyed_value>
+{
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef value_storage<key_type, mapped_type, keyed_value> type;
+    typedef std::pair<key_type, mapped_type> value_holder;
+
+    static constexpr bool keyless = false;
+
+    template<typename... Args>
+    static void construct(value_holder * p, const key_type & key, Args &&... args)
+    {
+        new((void *)p) value_holder(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    // key to build the prefixes from, prefixes sharing memory point into it
+    static const key_type & stored_key(const value_holder & holder, const key_type & key) noexcept
+    {
+        return holder.first;
+    }
+
+    static mapped_type & value(value_holder & holder) noexcept
+    {
+        return holder.second;
+    }
+
+    static const mapped_type & value(const value_holder & holder) noexcept
+    {
+        return holder.second;
+    }
+};
+
+template<typename K, typename V>
+struct value_storage<K, V, keyless_value>
+{
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef value_storage<key_type, mapped_type, keyless_value> type;
+    typedef mapped_type value_holder;
+
+    static constexpr bool keyless = true;
+
+    template<typename... Args>
+    static void construct(value_holder * p, const key_type & key, Args &&... args)
+    {
+        new((void *)p) value_holder(std::forward<Args>(args)...);
+    }
+
+    static const key_type & stored_key(const value_holder & holder, const key_type & key) noexcept
+    {
+        return key;
+    }
+
+    static mapped_type & value(value_holder & holder) noexcept
+    {
+        return holder;
+    }
+
+    static const mapped_type & value(const value_holder & holder) noexcept
+    {
+        return holder;
+    }
+};
+
+#endif //PREFIX_TREE_VALUE_STORAGE_H